@@ -0,0 +1,38 @@
+import {Buffer} from 'dripcap';
+
+function segmentLength(parentLayer) {
+  let attrs = parentLayer.attrs;
+  if (attrs.totalLength != null && attrs.headerLength != null) {
+    return attrs.totalLength.data - attrs.headerLength.data * 4;
+  }
+  return parentLayer.payload.length;
+}
+
+// Verifies the checksum of a TCP/UDP segment carried in parentLayer.
+// Returns null when the segment is truncated or has no IP addresses.
+export function verifyChecksum(parentLayer, protocol, length) {
+  let payload = parentLayer.payload;
+  let src = parentLayer.attrs.src;
+  let dst = parentLayer.attrs.dst;
+  if (length == null) {
+    length = segmentLength(parentLayer);
+  }
+  if (src == null || dst == null || length > payload.length) {
+    return null;
+  }
+  let initial = Buffer.pseudoHeaderChecksum(src.data, dst.data, protocol, length);
+  return payload.checksum(0, length, initial) === 0xffff;
+}
+
+export function checksumStatus(ok, range) {
+  if (ok == null) {
+    return [];
+  }
+  return [{
+    name: 'Status',
+    value: ok ? 'Good' : 'Bad',
+    range: range
+  }];
+}
+
+export default function () {}
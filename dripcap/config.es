@@ -8,6 +8,8 @@ export default {
   homePath: homePath,
   userPackagePath: path.join(homePath, '/packages'),
   profilePath: path.join(homePath, '/profiles'),
+  codeCachePath: path.join(homePath, '/cache/code'),
+  bundleCachePath: path.join(homePath, '/cache/bundle'),
   packagePath: path.join(path.dirname(__dirname), '/../packages'),
   electronVersion: pkg.devDependencies.electron,
   version: pkg.version,
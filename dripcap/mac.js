@@ -1,8 +1,7 @@
 import {Value} from 'dripcap';
 
 export function MACAddress(buffer) {
-  let val = buffer.toString('hex').replace(/..(?=.)/g, '$&:');
-  return new Value(val, 'dripcap/mac');
+  return new Value(buffer, 'dripcap/mac');
 }
 
 export default function () {}
@@ -19,6 +19,8 @@ import {Session} from 'paperfilter';
 
 mkpath.sync(config.userPackagePath);
 mkpath.sync(config.profilePath);
+mkpath.sync(config.codeCachePath);
+mkpath.sync(config.bundleCachePath);
 
 if (process.platform === 'darwin' && !Session.permission) {
   try {
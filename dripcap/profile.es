@@ -72,7 +72,12 @@ export default class Profile {
       snaplen: 1600,
       theme: 'default',
       "package-registry": 'dripcap.org',
-      startupDialog: true
+      startupDialog: true,
+      queueLimit: 200000,
+      queueLimitBytes: 256 * 1024 * 1024,
+      overflowPolicy: 'block',
+      scriptTimeout: 1000,
+      scriptTimeoutLimit: 3
     });
     this._config.set('package-registry', 'dripcap.org');
 
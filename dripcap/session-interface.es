@@ -17,12 +17,14 @@ export default class SessionInterface extends EventEmitter {
     return Session.devices;
   }
 
-  registerDissector(script) {
+  registerDissector(script, option = {}) {
     this._dissectors.push({
-      script
+      script,
+      native: option.native
     });
+    // A session logs a dissector that fails to load and resets itself.
     for (let sess of this.list) {
-      sess.registerDissector(script);
+      sess.registerDissector(script, option).catch(() => {});
     }
   }
 
@@ -41,7 +43,7 @@ export default class SessionInterface extends EventEmitter {
       this._dissectors.splice(index, 1);
     }
     for (let sess of this.list) {
-      sess.unregisterDissector(script);
+      sess.unregisterDissector(script).catch(() => {});
     }
   }
 
@@ -59,7 +61,14 @@ export default class SessionInterface extends EventEmitter {
     let option = {
       namespace: '::<Ethernet>',
       dissectors: this._dissectors,
-      stream_dissectors: this._streamDissectors
+      stream_dissectors: this._streamDissectors,
+      code_cache: config.codeCachePath,
+      bundle_cache: config.bundleCachePath,
+      queue_limit: this.parent.profile.getConfig('queueLimit'),
+      queue_limit_bytes: this.parent.profile.getConfig('queueLimitBytes'),
+      overflow_policy: this.parent.profile.getConfig('overflowPolicy'),
+      script_timeout: this.parent.profile.getConfig('scriptTimeout'),
+      script_timeout_limit: this.parent.profile.getConfig('scriptTimeoutLimit')
     };
 
     let sess = await Session.create(option);
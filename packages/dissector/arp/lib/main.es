@@ -4,10 +4,10 @@ import {
 
 export default class ARP {
   activate() {
-    Session.registerDissector(`${__dirname}/arp.es`);
+    Session.registerDissector(`${__dirname}/arp.json`);
   }
 
   deactivate() {
-    Session.unregisterDissector(`${__dirname}/arp.es`);
+    Session.unregisterDissector(`${__dirname}/arp.json`);
   }
 }
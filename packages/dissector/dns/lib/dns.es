@@ -6,7 +6,7 @@ export default class DNSDissector {
     return ['::Ethernet::IPv4::UDP'];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -7,7 +7,7 @@ export default class Dissector {
     return ['::<Ethernet>'];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -47,7 +47,9 @@ export default class Dissector {
         0x0842: 'WoL',
         0x809B: 'AppleTalk',
         0x80F3: 'AARP',
-        0x86DD: 'IPv6'
+        0x8100: 'VLAN',
+        0x86DD: 'IPv6',
+        0x88A8: 'QinQ'
       };
 
       let etherType = Enum(table, type);
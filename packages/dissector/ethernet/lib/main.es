@@ -4,10 +4,12 @@ import {
 
 export default class Ethernet {
   activate() {
-    Session.registerDissector(`${__dirname}/eth.es`);
+    Session.registerDissector(`${__dirname}/eth.es`, {native: 'ethernet'});
+    Session.registerDissector(`${__dirname}/vlan.es`, {native: 'vlan'});
   }
 
   deactivate() {
     Session.unregisterDissector(`${__dirname}/eth.es`);
+    Session.unregisterDissector(`${__dirname}/vlan.es`);
   }
 }
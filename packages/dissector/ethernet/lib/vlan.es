@@ -0,0 +1,90 @@
+import {Layer, Item, Value} from 'dripcap';
+import {Enum} from 'dripcap/utils';
+
+export default class Dissector {
+  static get namespaces() {
+    return ['::Ethernet::<VLAN>', '::Ethernet::<QinQ>'];
+  }
+
+  static analyze(packet, parentLayer) {
+    let layer = {
+      items: [],
+      attrs: {}
+    };
+    layer.namespace = '::Ethernet::VLAN';
+    layer.name = 'VLAN';
+    layer.id = 'vlan';
+
+    let table = {
+      0x0800: 'IPv4',
+      0x0806: 'ARP',
+      0x0842: 'WoL',
+      0x809B: 'AppleTalk',
+      0x80F3: 'AARP',
+      0x8100: 'VLAN',
+      0x86DD: 'IPv6',
+      0x88A8: 'QinQ'
+    };
+
+    let offset = 0;
+    let type;
+    let ids = [];
+    do {
+      let [tci, tagType] = parentLayer.payload.unpack('>HH', offset);
+      type = tagType;
+      let id = tci & 0x0fff;
+      let priority = tci >> 13;
+      let dropEligible = !!(tci & 0x1000);
+      ids.push(id);
+
+      layer.items.push({
+        name: 'Tag',
+        value: id,
+        range: `${offset}:${offset + 4}`,
+        items: [{
+          name: 'Priority',
+          value: priority,
+          range: `${offset}:${offset + 1}`
+        }, {
+          name: 'Drop Eligible',
+          value: dropEligible,
+          range: `${offset}:${offset + 1}`
+        }, {
+          name: 'VLAN Identifier',
+          value: id,
+          range: `${offset}:${offset + 2}`
+        }, {
+          name: 'EtherType',
+          value: Enum(table, type),
+          range: `${offset + 2}:${offset + 4}`
+        }]
+      });
+
+      if (offset === 0) {
+        layer.attrs.priority = priority;
+        layer.attrs.dropEligible = dropEligible;
+        layer.attrs.vid = id;
+      }
+      offset += 4;
+    } while (type === 0x8100 || type === 0x88A8);
+
+    layer.attrs.etherType = Enum(table, type);
+
+    layer.summary = 'VLAN ' + ids.join(' ');
+    let protocolName = table[type];
+    if (protocolName != null) {
+      layer.namespace = `::Ethernet::<${protocolName}>`;
+      layer.summary = `[${protocolName}] ` + layer.summary;
+    }
+
+    layer.range = offset + ':';
+    layer.payload = parentLayer.payload.slice(offset);
+    layer.items.push({
+      name: 'Payload',
+      value: layer.payload,
+      range: offset + ':'
+    });
+
+    return new Layer(layer);
+  }
+};
@@ -7,7 +7,7 @@ export default class Dissector {
     return ['::Ethernet::<IPv4>'];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -124,12 +124,19 @@ export default class Dissector {
     }
 
     let checksum = parentLayer.payload.readUInt16BE(10);
+    let checksumOk = parentLayer.payload.checksum(0, headerLength * 4) === 0xffff;
     layer.items.push({
       name: 'Header Checksum',
       value: checksum,
       range: '10:12',
+      items: [{
+        name: 'Status',
+        value: checksumOk ? 'Good' : 'Bad',
+        range: '10:12'
+      }]
     });
     layer.attrs.checksum = checksum;
+    layer.attrs.checksumOk = checksumOk;
 
     let source = IPv4Address(parentLayer.payload.slice(12, 16));
     layer.items.push({
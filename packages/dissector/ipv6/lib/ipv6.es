@@ -7,7 +7,7 @@ export default class IPv6Dissector {
     return ['::Ethernet::<IPv6>'];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -4,7 +4,7 @@ import {
 
 export default class TCP {
   activate() {
-    Session.registerDissector(`${__dirname}/tcp.es`);
+    Session.registerDissector(`${__dirname}/tcp.es`, {native: 'tcp'});
     Session.registerStreamDissector(`${__dirname}/tcp_stream.es`);
   }
 
@@ -1,5 +1,6 @@
 import {Layer, Item, Value, StreamChunk} from 'dripcap';
 import {Flags, Enum} from 'dripcap/utils';
+import {verifyChecksum, checksumStatus} from 'dripcap/checksum';
 import {IPv4Host} from 'dripcap/ipv4';
 import {IPv6Host} from 'dripcap/ipv6';
 
@@ -8,7 +9,7 @@ export default class Dissector {
     return [/::Ethernet::\w+::<TCP>/];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -17,14 +18,15 @@ export default class Dissector {
     layer.name = 'TCP';
     layer.id = 'tcp';
 
-    let source = parentLayer.payload.readUInt16BE(0);
+    let [source, destination, seq, ack, offsetFlags, window, checksum, urgent] =
+      parentLayer.payload.unpack('>HHIIHHHH', 0);
+
     layer.items.push({
       name: 'Source port',
       value: source,
       range: '0:2'
     });
 
-    let destination = parentLayer.payload.readUInt16BE(2);
     layer.items.push({
       name: 'Destination port',
       value: destination,
@@ -41,7 +43,6 @@ export default class Dissector {
       layer.attrs.dst = IPv6Host(dstAddr.data, destination);
     }
 
-    let seq = parentLayer.payload.readUInt32BE(4);
     layer.items.push({
       name: 'Sequence number',
       value: seq,
@@ -49,7 +50,6 @@ export default class Dissector {
     });
     layer.attrs.seq = seq;
 
-    let ack = parentLayer.payload.readUInt32BE(8);
     layer.items.push({
       name: 'Acknowledgment number',
       value: ack,
@@ -57,7 +57,7 @@ export default class Dissector {
     });
     layer.attrs.ack = ack;
 
-    let dataOffset = parentLayer.payload.readUInt8(12) >> 4;
+    let dataOffset = offsetFlags >> 12;
     layer.items.push({
       name: 'Data offset',
       value: dataOffset,
@@ -77,8 +77,7 @@ export default class Dissector {
       'FIN': 0x1 << 0,
     };
 
-    let flags = Flags(table, parentLayer.payload.readUInt8(13) |
-      ((parentLayer.payload.readUInt8(12) & 0x1) << 8));
+    let flags = Flags(table, offsetFlags & 0x1ff);
 
     layer.items.push({
       name: 'Flags',
@@ -133,7 +132,6 @@ export default class Dissector {
       ]
     });
 
-    let window = parentLayer.payload.readUInt16BE(14);
     layer.items.push({
       name: 'Window size',
       value: window,
@@ -141,15 +139,18 @@ export default class Dissector {
     });
     layer.attrs.window = window;
 
-    let checksum = parentLayer.payload.readUInt16BE(16);
+    let checksumOk = verifyChecksum(parentLayer, 6);
     layer.items.push({
       name: 'Checksum',
       value: checksum,
-      range: '16:18'
+      range: '16:18',
+      items: checksumStatus(checksumOk, '16:18')
     });
     layer.attrs.checksum = checksum;
+    if (checksumOk != null) {
+      layer.attrs.checksumOk = checksumOk;
+    }
 
-    let urgent = parentLayer.payload.readUInt16BE(18);
     layer.items.push({
       name: 'Urgent pointer',
       value: urgent,
@@ -166,9 +167,10 @@ export default class Dissector {
     };
 
     let optionOffset = 20;
+    let bytes = parentLayer.payload.uint8Array();
 
     while (optionDataOffset > optionOffset) {
-      switch (parentLayer.payload[optionOffset]) {
+      switch (bytes[optionOffset]) {
         case 0:
           optionOffset = optionDataOffset;
           break;
@@ -195,7 +197,7 @@ export default class Dissector {
           optionItems.push('Window scale');
           option.items.push({
             name: 'Window scale',
-            value: parentLayer.payload.readUInt8(optionOffset + 2),
+            value: bytes[optionOffset + 2],
             range: `${optionOffset}:${optionOffset + 3}`
           });
           optionOffset += 3;
@@ -212,7 +214,7 @@ export default class Dissector {
 
         // TODO: https://tools.ietf.org/html/rfc2018
         case 5:
-          let length = parentLayer.payload.readUInt8(optionOffset + 1);
+          let length = bytes[optionOffset + 1];
           optionItems.push('Selective ACK');
           option.items.push({
             name: 'Selective ACK',
@@ -1,13 +1,14 @@
 import {Layer, Item, Value} from 'dripcap';
 import {IPv4Host} from 'dripcap/ipv4';
 import {IPv6Host} from 'dripcap/ipv6';
+import {verifyChecksum, checksumStatus} from 'dripcap/checksum';
 
 export default class UDPDissector {
   static get namespaces() {
     return [/::Ethernet::\w+::<UDP>/];
   }
 
-  analyze(packet, parentLayer) {
+  static analyze(packet, parentLayer) {
     let layer = {
       items: [],
       attrs: {}
@@ -16,14 +17,15 @@ export default class UDPDissector {
     layer.name = 'UDP';
     layer.id = 'udp';
 
-    let source = parentLayer.payload.readUInt16BE(0);
+    let [source, destination, length, checksum] =
+      parentLayer.payload.unpack('>HHHH', 0);
+
     layer.items.push({
       name: 'Source port',
       value: source,
       range: '0:2'
     });
 
-    let destination = parentLayer.payload.readUInt16BE(2);
     layer.items.push({
       name: 'Destination port',
       value: destination,
@@ -40,7 +42,6 @@ export default class UDPDissector {
       layer.attrs.dst = IPv6Host(dstAddr.data, destination);
     }
 
-    let length = parentLayer.payload.readUInt16BE(4);
     layer.items.push({
       name: 'Length',
       value: length,
@@ -48,13 +49,17 @@ export default class UDPDissector {
     });
     layer.attrs.length = length;
 
-    let checksum = parentLayer.payload.readUInt16BE(6);
+    let checksumOk = (checksum === 0) ? null : verifyChecksum(parentLayer, 17, length);
     layer.items.push({
       name: 'Checksum',
       value: checksum,
-      range: '6:8'
+      range: '6:8',
+      items: checksumStatus(checksumOk, '6:8')
     });
     layer.attrs.checksum = checksum;
+    if (checksumOk != null) {
+      layer.attrs.checksumOk = checksumOk;
+    }
 
     layer.range = '8:'+ length;
     layer.payload = parentLayer.payload.slice(8, length);
@@ -0,0 +1,192 @@
+#include "address.hpp"
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+bool parseIPv4(const std::string &str, std::string *addr) {
+  addr->clear();
+  size_t pos = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (i > 0 && (pos >= str.size() || str[pos++] != '.'))
+      return false;
+    size_t start = pos;
+    unsigned value = 0;
+    while (pos < str.size() &&
+           std::isdigit(static_cast<unsigned char>(str[pos])))
+      value = value * 10 + (str[pos++] - '0');
+    if (pos == start || pos - start > 3 || value > 255)
+      return false;
+    addr->push_back(static_cast<char>(value));
+  }
+  return pos == str.size();
+}
+
+bool parseIPv6(const std::string &str, std::string *addr) {
+  std::vector<uint16_t> head;
+  std::vector<uint16_t> tail;
+  bool compressed = false;
+  size_t pos = 0;
+  if (str.compare(0, 2, "::") == 0) {
+    compressed = true;
+    pos = 2;
+  }
+  while (pos < str.size()) {
+    size_t start = pos;
+    unsigned value = 0;
+    while (pos < str.size() &&
+           std::isxdigit(static_cast<unsigned char>(str[pos]))) {
+      char c = std::tolower(static_cast<unsigned char>(str[pos++]));
+      value = value * 16 + (std::isdigit(c) ? c - '0' : c - 'a' + 10);
+    }
+    if (pos == start || pos - start > 4)
+      return false;
+    (compressed ? tail : head).push_back(static_cast<uint16_t>(value));
+    if (pos == str.size())
+      break;
+    if (str[pos++] != ':')
+      return false;
+    if (pos < str.size() && str[pos] == ':') {
+      if (compressed)
+        return false;
+      compressed = true;
+      ++pos;
+    } else if (pos == str.size()) {
+      return false;
+    }
+  }
+  size_t groups = head.size() + tail.size();
+  if (compressed ? groups > 7 : groups != 8)
+    return false;
+  head.resize(8 - tail.size());
+  head.insert(head.end(), tail.begin(), tail.end());
+  addr->clear();
+  for (uint16_t group : head) {
+    addr->push_back(static_cast<char>(group >> 8));
+    addr->push_back(static_cast<char>(group & 0xff));
+  }
+  return true;
+}
+
+bool parseMAC(const std::string &str, std::string *addr) {
+  if (str.size() != 17)
+    return false;
+  addr->clear();
+  for (size_t i = 0; i < 17; i += 3) {
+    if (i > 0 && str[i - 1] != ':' && str[i - 1] != '-')
+      return false;
+    unsigned value = 0;
+    for (size_t j = i; j < i + 2; ++j) {
+      char c = std::tolower(static_cast<unsigned char>(str[j]));
+      if (!std::isxdigit(static_cast<unsigned char>(c)))
+        return false;
+      value = value * 16 + (std::isdigit(c) ? c - '0' : c - 'a' + 10);
+    }
+    addr->push_back(static_cast<char>(value));
+  }
+  return true;
+}
+
+// Formats with the longest run of two or more zero groups compressed to
+// "::" as recommended by RFC 5952.
+std::string formatIPv6(const uint8_t *bytes) {
+  uint16_t groups[8];
+  for (int i = 0; i < 8; ++i) {
+    groups[i] = (bytes[i * 2] << 8) | bytes[i * 2 + 1];
+  }
+  int bestStart = -1;
+  int bestLength = 1;
+  for (int i = 0; i < 8;) {
+    if (groups[i] != 0) {
+      ++i;
+      continue;
+    }
+    int start = i;
+    while (i < 8 && groups[i] == 0)
+      ++i;
+    if (i - start > bestLength) {
+      bestStart = start;
+      bestLength = i - start;
+    }
+  }
+
+  std::string str;
+  char buf[8];
+  for (int i = 0; i < 8; ++i) {
+    if (i == bestStart) {
+      str += "::";
+      i += bestLength - 1;
+      continue;
+    }
+    if (!str.empty() && str.back() != ':')
+      str += ':';
+    std::snprintf(buf, sizeof(buf), "%x", groups[i]);
+    str += buf;
+  }
+  return str;
+}
+}
+
+namespace Address {
+bool parse(const std::string &str, std::string *bytes) {
+  return parseIPv4(str, bytes) || parseIPv6(str, bytes) || parseMAC(str, bytes);
+}
+
+std::string format(const char *data, size_t size) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  char buf[32];
+  if (size == 4) {
+    std::snprintf(buf, sizeof(buf), "%u.%u.%u.%u", bytes[0], bytes[1],
+                  bytes[2], bytes[3]);
+    return buf;
+  } else if (size == 6) {
+    std::snprintf(buf, sizeof(buf), "%02x:%02x:%02x:%02x:%02x:%02x",
+                  bytes[0], bytes[1], bytes[2], bytes[3], bytes[4], bytes[5]);
+    return buf;
+  } else if (size == 16) {
+    return formatIPv6(bytes);
+  }
+  return std::string();
+}
+
+bool parseNetwork(const std::string &str, std::string *bytes,
+                  size_t *prefix) {
+  size_t slash = str.find('/');
+  if (!parse(str.substr(0, slash), bytes))
+    return false;
+  size_t bits = bytes->size() * 8;
+  if (slash == std::string::npos) {
+    *prefix = bits;
+    return true;
+  }
+  const std::string &num = str.substr(slash + 1);
+  if (num.empty() || num.size() > 3)
+    return false;
+  size_t value = 0;
+  for (char c : num) {
+    if (!std::isdigit(static_cast<unsigned char>(c)))
+      return false;
+    value = value * 10 + (c - '0');
+  }
+  if (value > bits)
+    return false;
+  *prefix = value;
+  return true;
+}
+
+bool inNetwork(const char *data, size_t size, const std::string &network,
+               size_t prefix) {
+  if (size != network.size())
+    return false;
+  size_t full = prefix / 8;
+  if (std::memcmp(data, network.data(), full) != 0)
+    return false;
+  size_t rest = prefix % 8;
+  if (rest == 0)
+    return true;
+  uint8_t mask = static_cast<uint8_t>(0xff << (8 - rest));
+  return ((data[full] ^ network[full]) & mask) == 0;
+}
+}
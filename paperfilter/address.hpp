@@ -0,0 +1,18 @@
+#ifndef ADDRESS_HPP
+#define ADDRESS_HPP
+
+#include <cstddef>
+#include <string>
+
+// Raw IPv4 (4 bytes), IPv6 (16 bytes) and MAC (6 bytes) addresses.
+namespace Address {
+bool parse(const std::string &str, std::string *bytes);
+std::string format(const char *data, size_t size);
+
+// Parses "addr/prefix"; a bare address is a network of its full width.
+bool parseNetwork(const std::string &str, std::string *bytes, size_t *prefix);
+bool inNetwork(const char *data, size_t size, const std::string &network,
+               size_t prefix);
+}
+
+#endif
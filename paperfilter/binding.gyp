@@ -9,24 +9,38 @@
             "main.cpp",
             "log_message.cpp",
             "console.cpp",
+            "address.cpp",
             "buffer.cpp",
+            "byte_ops.cpp",
+            "code_cache.cpp",
             "large_buffer.cpp",
             "layer.cpp",
+            "layer_id.cpp",
+            "option_keys.cpp",
+            "namespace_table.cpp",
+            "native_dissector.cpp",
+            "native_values.cpp",
+            "builtin_dissectors.cpp",
+            "table_dissector.cpp",
+            "wasm_dissector.cpp",
             "item.cpp",
             "item_value.cpp",
             "session.cpp",
             "packet.cpp",
             "packet_store.cpp",
+            "payload_index.cpp",
             "packet_dispatcher.cpp",
             "filtered_packet_store.cpp",
             "stream_chunk.cpp",
             "paper_context.cpp",
             "dissector.cpp",
+            "dissector_stats.cpp",
             "dissector_thread.cpp",
             "stream_dissector_thread.cpp",
             "filter.cpp",
             "filter_thread.cpp",
             "stream_dispatcher.cpp",
+            "watchdog.cpp",
             "vendor/json11/json11.cpp"
          ],
          "include_dirs":[
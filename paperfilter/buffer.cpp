@@ -1,41 +1,14 @@
 #include "buffer.hpp"
-#include <iomanip>
-#include <sstream>
+#include "address.hpp"
+#include "byte_ops.hpp"
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <string>
 #include <v8pp/class.hpp>
 
 using namespace v8;
 
-namespace {
-int search(const char *str, int strlen, const char *sub, int sublen) {
-  if (sublen > strlen)
-    return -1;
-  if (sublen == 0)
-    return 0;
-  int index = sublen;
-  while (index <= strlen) {
-    int shift = sublen;
-    for (int i = 0; i < sublen; ++i) {
-      char c = str[index - i - 1];
-      if (sub[sublen - i - 1] == c) {
-        shift--;
-        continue;
-      }
-      for (int j = 1; j < sublen - i; ++j) {
-        if (sub[sublen - i - j - 1] == c) {
-          shift = j;
-          i = sublen;
-          break;
-        }
-      }
-    }
-    if (shift == 0)
-      return index - sublen;
-    index += shift;
-  }
-  return -1;
-}
-}
-
 class Buffer::Private {
 public:
   Private();
@@ -75,14 +48,9 @@ Buffer::Buffer(const v8::FunctionCallbackInfo<v8::Value> &args)
     if (type == "utf8") {
       buf->assign(str.begin(), str.end());
     } else if (type == "hex") {
-      try {
-        if (str.size() % 2 != 0) {
-          throw std::invalid_argument("");
-        }
-        for (size_t i = 0; i < str.size() / 2; ++i) {
-          buf->push_back(std::stoul(str.substr(i * 2, 2), nullptr, 16));
-        }
-      } catch (const std::invalid_argument &e) {
+      buf->resize(str.size() / 2);
+      if (str.size() % 2 != 0 ||
+          !ByteOps::hexDecode(str.data(), str.size(), buf->data())) {
         throw std::invalid_argument("Invalid hex string");
       }
     } else {
@@ -133,84 +101,248 @@ void Buffer::sliceBuffer(
       v8pp::class_<Buffer>::import_external(isolate, slice(s, e).release()));
 }
 
-void Buffer::readInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const {
+namespace {
+// Keeps the storage behind an externalized ArrayBuffer alive until the
+// ArrayBuffer is collected.
+struct ArrayBufferHolder {
+  v8::Persistent<v8::ArrayBuffer> handle;
+  std::shared_ptr<std::vector<char>> source;
+};
+
+// Accepts a Buffer holding the raw address or its textual form.
+bool addressBytes(v8::Isolate *isolate, v8::Local<v8::Value> value,
+                  std::vector<char> *addr) {
+  if (Buffer *buffer = v8pp::class_<Buffer>::unwrap_object(isolate, value)) {
+    addr->assign(buffer->data(), buffer->data() + buffer->length());
+    return addr->size() == 4 || addr->size() == 16;
+  }
+  const std::string &str = v8pp::from_v8<std::string>(isolate, value, "");
+  std::string bytes;
+  if (!Address::parse(str, &bytes))
+    return false;
+  addr->assign(bytes.begin(), bytes.end());
+  return addr->size() == 4 || addr->size() == 16;
+}
+
+template <class T> T readRaw(const char *data, bool littleEndian) {
+  char buf[sizeof(T)];
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    buf[i] = littleEndian ? data[i] : data[sizeof(T) - i - 1];
+  }
+  T value;
+  std::memcpy(&value, buf, sizeof(T));
+  return value;
+}
+
+// 64-bit integers are returned as doubles and lose precision above 2^53.
+template <class T> double readNumber(const char *data, bool littleEndian) {
+  return static_cast<double>(readRaw<T>(data, littleEndian));
+}
+}
+
+template <class T>
+void Buffer::read(const v8::FunctionCallbackInfo<v8::Value> &args,
+                  bool littleEndian) const {
   Isolate *isolate = Isolate::GetCurrent();
   size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
   bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int8_t) > length()) {
+  if (!noassert && offset + sizeof(T) > length()) {
     args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
   } else {
-    args.GetReturnValue().Set(data(offset)[0]);
+    args.GetReturnValue().Set(
+        Number::New(isolate, readNumber<T>(data(offset), littleEndian)));
   }
 }
 
+void Buffer::readInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<int8_t>(args, false);
+}
+
 void Buffer::readInt16BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int16_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[2] = {data(offset)[1], data(offset)[0]};
-    int16_t num = *reinterpret_cast<const int16_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  read<int16_t>(args, false);
+}
+
+void Buffer::readInt16LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<int16_t>(args, true);
 }
 
 void Buffer::readInt32BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(int32_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[4] = {data(offset)[3], data(offset)[2], data(offset)[1],
-                         data(offset)[0]};
-    int32_t num = *reinterpret_cast<const int32_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  read<int32_t>(args, false);
+}
+
+void Buffer::readInt32LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<int32_t>(args, true);
+}
+
+void Buffer::readInt64BE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<int64_t>(args, false);
+}
+
+void Buffer::readInt64LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<int64_t>(args, true);
 }
 
 void Buffer::readUInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint8_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    args.GetReturnValue().Set(*reinterpret_cast<const uint8_t *>(data(offset)));
-  }
+  read<uint8_t>(args, false);
 }
 
 void Buffer::readUInt16BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
-  Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint16_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[2] = {data(offset)[1], data(offset)[0]};
-    uint16_t num = *reinterpret_cast<const uint16_t *>(buf);
-    args.GetReturnValue().Set(num);
-  }
+  read<uint16_t>(args, false);
+}
+
+void Buffer::readUInt16LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<uint16_t>(args, true);
 }
 
 void Buffer::readUInt32BE(
     const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<uint32_t>(args, false);
+}
+
+void Buffer::readUInt32LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<uint32_t>(args, true);
+}
+
+void Buffer::readUInt64BE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<uint64_t>(args, false);
+}
+
+void Buffer::readUInt64LE(
+    const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  read<uint64_t>(args, true);
+}
+
+// Decodes fields described by a struct-style format such as '>HHIIBB' into
+// an array. '<' and '>' (or '!') select the byte order, a decimal prefix
+// repeats a field, 'x' skips a byte and 'Ns' yields an N-byte Buffer slice.
+void Buffer::unpack(const v8::FunctionCallbackInfo<v8::Value> &args) const {
   Isolate *isolate = Isolate::GetCurrent();
-  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
-  bool noassert = v8pp::from_v8<bool>(isolate, args[1], true);
-  if (!noassert && offset + sizeof(uint32_t) > length()) {
-    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
-  } else {
-    const char buf[4] = {data(offset)[3], data(offset)[2], data(offset)[1],
-                         data(offset)[0]};
-    uint32_t num = *reinterpret_cast<const uint32_t *>(buf);
-    args.GetReturnValue().Set(num);
+  const std::string &format =
+      v8pp::from_v8<std::string>(isolate, args[0], "");
+  size_t offset = v8pp::from_v8<size_t>(isolate, args[1], 0);
+  bool littleEndian = false;
+  Local<Array> values = Array::New(isolate);
+  uint32_t index = 0;
+
+  for (size_t i = 0; i < format.size(); ++i) {
+    char c = format[i];
+    if (c == '<' || c == '>' || c == '!') {
+      littleEndian = (c == '<');
+      continue;
+    }
+
+    // Counts beyond the buffer length are out of range anyway, so they
+    // stop growing there instead of wrapping around.
+    size_t count = 1;
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      count = 0;
+      while (i < format.size() &&
+             std::isdigit(static_cast<unsigned char>(format[i]))) {
+        if (count <= length())
+          count = count * 10 + (format[i] - '0');
+        ++i;
+      }
+      if (i >= format.size()) {
+        args.GetReturnValue().Set(
+            v8pp::throw_ex(isolate, "Missing format character after count"));
+        return;
+      }
+      c = format[i];
+    }
+
+    size_t size;
+    switch (c) {
+    case 'x':
+    case 'b':
+    case 'B':
+    case 's':
+      size = 1;
+      break;
+    case 'h':
+    case 'H':
+      size = 2;
+      break;
+    case 'i':
+    case 'I':
+    case 'f':
+      size = 4;
+      break;
+    case 'q':
+    case 'Q':
+    case 'd':
+      size = 8;
+      break;
+    default:
+      std::string err("Unknown format character: ");
+      args.GetReturnValue().Set(v8pp::throw_ex(isolate, (err + c).c_str()));
+      return;
+    }
+
+    if (offset > length() || count > (length() - offset) / size) {
+      args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
+      return;
+    }
+
+    if (c == 'x') {
+      offset += count;
+      continue;
+    } else if (c == 's') {
+      Buffer *buf = slice(offset, offset + count).release();
+      values->Set(index++,
+                  v8pp::class_<Buffer>::import_external(isolate, buf));
+      offset += count;
+      continue;
+    }
+
+    for (size_t n = 0; n < count; ++n, offset += size) {
+      const char *p = data(offset);
+      double value = 0;
+      switch (c) {
+      case 'b':
+        value = readNumber<int8_t>(p, littleEndian);
+        break;
+      case 'B':
+        value = readNumber<uint8_t>(p, littleEndian);
+        break;
+      case 'h':
+        value = readNumber<int16_t>(p, littleEndian);
+        break;
+      case 'H':
+        value = readNumber<uint16_t>(p, littleEndian);
+        break;
+      case 'i':
+        value = readNumber<int32_t>(p, littleEndian);
+        break;
+      case 'I':
+        value = readNumber<uint32_t>(p, littleEndian);
+        break;
+      case 'q':
+        value = readNumber<int64_t>(p, littleEndian);
+        break;
+      case 'Q':
+        value = readNumber<uint64_t>(p, littleEndian);
+        break;
+      case 'f':
+        value = readNumber<float>(p, littleEndian);
+        break;
+      case 'd':
+        value = readNumber<double>(p, littleEndian);
+        break;
+      }
+      values->Set(index++, Number::New(isolate, value));
+    }
   }
+  args.GetReturnValue().Set(values);
 }
 
 void Buffer::toString(const v8::FunctionCallbackInfo<v8::Value> &args) const {
@@ -222,13 +354,9 @@ void Buffer::toString(const v8::FunctionCallbackInfo<v8::Value> &args) const {
     args.GetReturnValue().Set(
         v8pp::to_v8(isolate, std::string(data(), length())));
   } else if (type == "hex") {
-    std::stringstream stream;
-    for (size_t i = 0; i < length(); ++i) {
-      stream << std::hex << std::setfill('0') << std::setw(2)
-             << static_cast<uint32_t>(
-                    *reinterpret_cast<const uint8_t *>(data(i)));
-    }
-    args.GetReturnValue().Set(v8pp::to_v8(isolate, stream.str()));
+    std::string str(length() * 2, '\0');
+    ByteOps::hexEncode(data(), length(), &str[0]);
+    args.GetReturnValue().Set(v8pp::to_v8(isolate, str));
   } else {
     std::string err("Unknown encoding: ");
     args.GetReturnValue().Set(v8pp::throw_ex(isolate, (err + type).c_str()));
@@ -238,13 +366,12 @@ void Buffer::toString(const v8::FunctionCallbackInfo<v8::Value> &args) const {
 std::string Buffer::valueOf() const {
   size_t tail = std::min(static_cast<size_t>(16), length());
   std::string str("<Buffer");
-  std::stringstream stream;
+  char hex[2];
   for (size_t i = 0; i < tail; ++i) {
-    stream << " " << std::hex << std::setfill('0') << std::setw(2)
-           << static_cast<uint32_t>(
-                  *reinterpret_cast<const uint8_t *>(data(i)));
+    ByteOps::hexEncode(data(i), 1, hex);
+    str += ' ';
+    str.append(hex, 2);
   }
-  str += stream.str();
   if (length() > 16)
     str += "...";
   return str + ">";
@@ -254,12 +381,86 @@ void Buffer::indexOf(const v8::FunctionCallbackInfo<v8::Value> &args) const {
   Isolate *isolate = Isolate::GetCurrent();
   if (Buffer *buffer = v8pp::class_<Buffer>::unwrap_object(isolate, args[0])) {
     args.GetReturnValue().Set(
-        search(data(), length(), buffer->data(), buffer->length()));
+        ByteOps::search(data(), length(), buffer->data(), buffer->length()));
+  } else if (args[0]->IsString()) {
+    const std::string &str = v8pp::from_v8<std::string>(isolate, args[0], "");
+    args.GetReturnValue().Set(
+        ByteOps::search(data(), length(), str.data(), str.size()));
   } else {
     args.GetReturnValue().Set(1);
   }
 }
 
+void Buffer::checksum(const v8::FunctionCallbackInfo<v8::Value> &args) const {
+  Isolate *isolate = Isolate::GetCurrent();
+  size_t offset = v8pp::from_v8<size_t>(isolate, args[0], 0);
+  size_t len = v8pp::from_v8<size_t>(isolate, args[1],
+                                     length() - std::min(offset, length()));
+  uint32_t initial = v8pp::from_v8<uint32_t>(isolate, args[2], 0);
+  if (offset + len > length()) {
+    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "index out of range"));
+  } else {
+    args.GetReturnValue().Set(ByteOps::checksum(data(offset), len, initial));
+  }
+}
+
+// Returns the partial sum of the TCP/UDP pseudo-header for
+// (src, dst, protocol, length), to be passed as the initial checksum value.
+void Buffer::pseudoHeaderChecksum(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  Isolate *isolate = Isolate::GetCurrent();
+  std::vector<char> header;
+  std::vector<char> dst;
+  if (!addressBytes(isolate, args[0], &header) ||
+      !addressBytes(isolate, args[1], &dst) || header.size() != dst.size()) {
+    args.GetReturnValue().Set(v8pp::throw_ex(isolate, "Invalid address"));
+    return;
+  }
+  uint32_t protocol = v8pp::from_v8<uint32_t>(isolate, args[2], 0);
+  uint32_t len = v8pp::from_v8<uint32_t>(isolate, args[3], 0);
+  header.insert(header.end(), dst.begin(), dst.end());
+  const char tail[] = {static_cast<char>(len >> 24),
+                       static_cast<char>(len >> 16),
+                       static_cast<char>(len >> 8),
+                       static_cast<char>(len),
+                       0,
+                       0,
+                       0,
+                       static_cast<char>(protocol)};
+  header.insert(header.end(), std::begin(tail), std::end(tail));
+  args.GetReturnValue().Set(
+      ByteOps::checksum(header.data(), header.size(), 0));
+}
+
+// The views share memory with the packet; dissectors must treat them as
+// read-only just like the Buffer itself.
+v8::Local<v8::ArrayBuffer> Buffer::arrayBuffer() const {
+  Isolate *isolate = Isolate::GetCurrent();
+  Local<ArrayBuffer> buffer =
+      ArrayBuffer::New(isolate, const_cast<char *>(data()), length(),
+                       ArrayBufferCreationMode::kExternalized);
+  ArrayBufferHolder *holder = new ArrayBufferHolder();
+  holder->source = d->source;
+  holder->handle.Reset(isolate, buffer);
+  holder->handle.SetWeak(
+      holder,
+      [](const WeakCallbackInfo<ArrayBufferHolder> &info) {
+        ArrayBufferHolder *holder = info.GetParameter();
+        holder->handle.Reset();
+        delete holder;
+      },
+      WeakCallbackType::kParameter);
+  return buffer;
+}
+
+v8::Local<v8::Uint8Array> Buffer::uint8Array() const {
+  return Uint8Array::New(arrayBuffer(), 0, length());
+}
+
+v8::Local<v8::DataView> Buffer::dataView() const {
+  return DataView::New(arrayBuffer(), 0, length());
+}
+
 void Buffer::get(uint32_t index,
                  const v8::PropertyCallbackInfo<v8::Value> &info) const {
   Isolate *isolate = Isolate::GetCurrent();
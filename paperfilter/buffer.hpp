@@ -19,17 +19,31 @@ public:
 
   void readInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readInt16BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt16LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readInt32BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt32LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt64BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readInt64LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
 
   void readUInt8(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readUInt16BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt16LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void readUInt32BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt32LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt64BE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void readUInt64LE(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+
+  void unpack(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  void checksum(const v8::FunctionCallbackInfo<v8::Value> &args) const;
 
   void get(uint32_t index,
            const v8::PropertyCallbackInfo<v8::Value> &info) const;
   void sliceBuffer(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void toString(const v8::FunctionCallbackInfo<v8::Value> &args) const;
   void indexOf(const v8::FunctionCallbackInfo<v8::Value> &args) const;
+  v8::Local<v8::ArrayBuffer> arrayBuffer() const;
+  v8::Local<v8::Uint8Array> uint8Array() const;
+  v8::Local<v8::DataView> dataView() const;
   std::string valueOf() const;
   const char *data(size_t offset = 0) const;
 
@@ -38,6 +52,13 @@ public:
 public:
   static void from(const v8::FunctionCallbackInfo<v8::Value> &args);
   static bool isBuffer(const v8::Local<v8::Value> &value);
+  static void
+  pseudoHeaderChecksum(const v8::FunctionCallbackInfo<v8::Value> &args);
+
+private:
+  template <class T>
+  void read(const v8::FunctionCallbackInfo<v8::Value> &args,
+            bool littleEndian) const;
 
 private:
   class Private;
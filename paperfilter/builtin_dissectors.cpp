@@ -0,0 +1,705 @@
+#include "builtin_dissectors.hpp"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "byte_ops.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "native_values.hpp"
+#include "stream_chunk.hpp"
+#include <algorithm>
+#include <json11.hpp>
+#include <stdexcept>
+#include <utility>
+
+namespace {
+using namespace NativeValues;
+
+const EnumTable etherTypeTable = {
+    {0x0800, "IPv4"},      {0x0806, "ARP"},  {0x0842, "WoL"},
+    {0x809B, "AppleTalk"}, {0x80F3, "AARP"}, {0x8100, "VLAN"},
+    {0x86DD, "IPv6"},      {0x88A8, "QinQ"}};
+
+const EnumTable protocolTable = {
+    {0x00, "HOPOPT"}, {0x01, "ICMP"}, {0x02, "IGMP"}, {0x03, "GGP"},
+    {0x04, "IP-in-IP"}, {0x05, "ST"}, {0x06, "TCP"}, {0x07, "CBT"},
+    {0x08, "EGP"}, {0x09, "IGP"}, {0x0A, "BBN-RCC-MON"}, {0x0B, "NVP-II"},
+    {0x0C, "PUP"}, {0x0D, "ARGUS"}, {0x0E, "EMCON"}, {0x0F, "XNET"},
+    {0x10, "CHAOS"}, {0x11, "UDP"}, {0x12, "MUX"}, {0x13, "DCN-MEAS"},
+    {0x14, "HMP"}, {0x15, "PRM"}, {0x16, "XNS-IDP"}, {0x17, "TRUNK-1"},
+    {0x18, "TRUNK-2"}, {0x19, "LEAF-1"}, {0x1A, "LEAF-2"}, {0x1B, "RDP"},
+    {0x1C, "IRTP"}, {0x1D, "ISO-TP4"}, {0x1E, "NETBLT"}, {0x1F, "MFE-NSP"},
+    {0x20, "MERIT-INP"}, {0x21, "DCCP"}, {0x22, "3PC"}, {0x23, "IDPR"},
+    {0x24, "XTP"}, {0x25, "DDP"}, {0x26, "IDPR-CMTP"}, {0x27, "TP++"},
+    {0x28, "IL"}, {0x29, "IPv6"}, {0x2A, "SDRP"}, {0x2B, "Route"},
+    {0x2C, "Frag"}, {0x2D, "IDRP"}, {0x2E, "RSVP"}, {0x2F, "GRE"},
+    {0x30, "MHRP"}, {0x31, "BNA"}, {0x32, "ESP"}, {0x33, "AH"},
+    {0x34, "I-NLSP"}, {0x35, "SWIPE"}, {0x36, "NARP"}, {0x37, "MOBILE"},
+    {0x38, "TLSP"}, {0x39, "SKIP"}, {0x3A, "ICMP"}, {0x3B, "NoNxt"},
+    {0x3C, "Opts"}, {0x3E, "CFTP"}, {0x40, "SAT-EXPAK"}, {0x41, "KRYPTOLAN"},
+    {0x42, "RVD"}, {0x43, "IPPC"}, {0x45, "SAT-MON"}, {0x46, "VISA"},
+    {0x47, "IPCU"}, {0x48, "CPNX"}, {0x49, "CPHB"}, {0x4A, "WSN"},
+    {0x4B, "PVP"}, {0x4C, "BR-SAT-MON"}, {0x4D, "SUN-ND"}, {0x4E, "WB-MON"},
+    {0x4F, "WB-EXPAK"}, {0x50, "ISO-IP"}, {0x51, "VMTP"},
+    {0x52, "SECURE-VMTP"}, {0x53, "VINES"}, {0x54, "IPTM"},
+    {0x55, "NSFNET-IGP"}, {0x56, "DGP"}, {0x57, "TCF"}, {0x58, "EIGRP"},
+    {0x59, "OSPF"}, {0x5A, "Sprite-RPC"}, {0x5B, "LARP"}, {0x5C, "MTP"},
+    {0x5D, "AX.25"}, {0x5E, "IPIP"}, {0x5F, "MICP"}, {0x60, "SCC-SP"},
+    {0x61, "ETHERIP"}, {0x62, "ENCAP"}, {0x64, "GMTP"}, {0x65, "IFMP"},
+    {0x66, "PNNI"}, {0x67, "PIM"}, {0x68, "ARIS"}, {0x69, "SCPS"},
+    {0x6A, "QNX"}, {0x6B, "A/N"}, {0x6C, "IPComp"}, {0x6D, "SNP"},
+    {0x6E, "Compaq-Peer"}, {0x6F, "IPX-in-IP"}, {0x70, "VRRP"}, {0x71, "PGM"},
+    {0x73, "L2TP"}, {0x74, "DDX"}, {0x75, "IATP"}, {0x76, "STP"},
+    {0x77, "SRP"}, {0x78, "UTI"}, {0x79, "SMP"}, {0x7A, "SM"}, {0x7B, "PTP"},
+    {0x7C, "IS-IS"}, {0x7D, "FIRE"}, {0x7E, "CRTP"}, {0x7F, "CRUDP"},
+    {0x80, "SSCOPMCE"}, {0x81, "IPLT"}, {0x82, "SPS"}, {0x83, "PIPE"},
+    {0x84, "SCTP"}, {0x85, "FC"}, {0x86, "RSVP-E2E-IGNORE"}, {0x87, "RFC6275"},
+    {0x88, "UDPLite"}, {0x89, "MPLS-in-IP"}, {0x8A, "manet"}, {0x8B, "HIP"},
+    {0x8C, "Shim6"}, {0x8D, "WESP"}, {0x8E, "ROHC"}};
+
+const FlagTable ipv4FlagTable = {
+    {"Reserved", 0x1}, {"Don't Fragment", 0x2}, {"More Fragments", 0x4}};
+
+const FlagTable tcpFlagTable = {
+    {"NS", 0x1 << 8},  {"CWR", 0x1 << 7}, {"ECE", 0x1 << 6},
+    {"URG", 0x1 << 5}, {"ACK", 0x1 << 4}, {"PSH", 0x1 << 3},
+    {"RST", 0x1 << 2}, {"SYN", 0x1 << 1}, {"FIN", 0x1 << 0}};
+
+struct Hosts {
+  std::string src;
+  std::string dst;
+  std::string type;
+};
+
+// IPv4Host() or IPv6Host() of the parent's addresses.
+Hosts hosts(const Layer &parentLayer, uint32_t srcPort, uint32_t dstPort) {
+  const ItemValue *src = attr(parentLayer, "src");
+  const ItemValue *dst = attr(parentLayer, "dst");
+  if (!src || !dst)
+    throw std::invalid_argument("parent layer has no addresses");
+  Hosts hosts;
+  if (src->type() == "dripcap/ipv4/addr") {
+    hosts.type = "dripcap/ipv4/host";
+  } else if (src->type() == "dripcap/ipv6/addr") {
+    hosts.type = "dripcap/ipv6/host";
+  } else {
+    throw std::invalid_argument("parent layer has no IP addresses");
+  }
+  hosts.src = formatAddress(*src) + ":" + std::to_string(srcPort);
+  hosts.dst = formatAddress(*dst) + ":" + std::to_string(dstPort);
+  return hosts;
+}
+
+void addChecksumStatus(Item *item, int ok, const std::string &range) {
+  if (ok >= 0)
+    item->addItem(Item("Status", text(ok ? "Good" : "Bad"), range));
+}
+
+// Mirrors verifyChecksum() in dripcap/checksum: 1 or 0, or -1 when the
+// segment is truncated or the parent carries no addresses.
+int verifyChecksum(const Layer &parentLayer, const Buffer &payload,
+                   uint8_t protocol, double length = -1) {
+  if (length < 0) {
+    const ItemValue *totalLength = attr(parentLayer, "totalLength");
+    const ItemValue *headerLength = attr(parentLayer, "headerLength");
+    if (totalLength && headerLength) {
+      length = totalLength->number() - headerLength->number() * 4;
+    } else {
+      length = payload.length();
+    }
+  }
+  const ItemValue *src = attr(parentLayer, "src");
+  const ItemValue *dst = attr(parentLayer, "dst");
+  if (!src || !dst || length > payload.length())
+    return -1;
+  if (src->base() != ItemValue::ADDRESS || dst->base() != ItemValue::ADDRESS ||
+      src->address().size() != dst->address().size())
+    throw std::invalid_argument("Invalid address");
+  if (length < 0)
+    throw std::out_of_range(outOfRange);
+
+  const uint32_t len = static_cast<uint32_t>(length);
+  std::string header = src->address() + dst->address();
+  const char tail[] = {static_cast<char>(len >> 24),
+                       static_cast<char>(len >> 16),
+                       static_cast<char>(len >> 8),
+                       static_cast<char>(len),
+                       0,
+                       0,
+                       0,
+                       static_cast<char>(protocol)};
+  header.append(tail, sizeof(tail));
+  const uint16_t initial = ByteOps::checksum(header.data(), header.size(), 0);
+  return ByteOps::checksum(payload.data(), len, initial) == 0xffff;
+}
+
+class Ethernet : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({"::<Ethernet>"}, {});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *) const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>("::Ethernet");
+    layer->setName("Ethernet");
+    layer->setId("eth");
+
+    const ItemValue destination(slice(*payload, 0, 6), "dripcap/mac");
+    layer->addItem(Item("Destination", destination, "0:6"));
+    layer->setAttr("dst", destination);
+
+    const ItemValue source(slice(*payload, 6, 12), "dripcap/mac");
+    layer->addItem(Item("Source", source, "6:12"));
+    layer->setAttr("src", source);
+
+    const std::string *protocolName = nullptr;
+    const uint16_t type = readUInt16BE(*payload, 12);
+    if (type <= 1500) {
+      layer->addItem(Item("Length", number(type), "12:14"));
+    } else {
+      const ItemValue etherType = enumValue(etherTypeTable, type);
+      layer->addItem(Item("EtherType", etherType, "12:14"));
+      layer->setAttr("etherType", etherType);
+
+      protocolName = enumName(etherTypeTable, type);
+      if (protocolName) {
+        layer->setNs("::Ethernet::<" + *protocolName + ">");
+      }
+    }
+
+    std::string summary =
+        formatAddress(source) + " -> " + formatAddress(destination);
+    if (protocolName) {
+      summary = "[" + *protocolName + "] " + summary;
+    }
+    layer->setSummary(summary);
+
+    layer->setRange("14:");
+    layer->setPayload(slice(*payload, 14));
+    layer->addItem(Item("Payload", ItemValue(slice(*payload, 14)), "14:"));
+    layers->push_back(layer);
+  }
+};
+
+// 802.1Q and 802.1ad tags. Stacked tags are decoded into one layer, whose
+// namespace names the encapsulated protocol as Ethernet would.
+class VLAN : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({"::Ethernet::<VLAN>", "::Ethernet::<QinQ>"},
+                               {});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *) const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>("::Ethernet::VLAN");
+    layer->setName("VLAN");
+    layer->setId("vlan");
+
+    size_t offset = 0;
+    uint16_t type = 0;
+    std::vector<uint16_t> ids;
+    do {
+      const uint16_t tci = readUInt16BE(*payload, offset);
+      type = readUInt16BE(*payload, offset + 2);
+      const uint16_t id = tci & 0x0fff;
+      ids.push_back(id);
+
+      Item tag("Tag", number(id), range(offset, offset + 4));
+      tag.addItem(
+          Item("Priority", number(tci >> 13), range(offset, offset + 1)));
+      tag.addItem(Item("Drop Eligible", ItemValue(bool(tci & 0x1000)),
+                       range(offset, offset + 1)));
+      tag.addItem(Item("VLAN Identifier", number(id),
+                       range(offset, offset + 2)));
+      tag.addItem(Item("EtherType", enumValue(etherTypeTable, type),
+                       range(offset + 2, offset + 4)));
+      layer->addItem(tag);
+
+      if (offset == 0) {
+        layer->setAttr("priority", number(tci >> 13));
+        layer->setAttr("dropEligible", ItemValue(bool(tci & 0x1000)));
+        layer->setAttr("vid", number(id));
+      }
+      offset += 4;
+    } while (type == 0x8100 || type == 0x88A8);
+
+    const ItemValue etherType = enumValue(etherTypeTable, type);
+    layer->setAttr("etherType", etherType);
+
+    std::string summary = "VLAN";
+    for (uint16_t id : ids) {
+      summary += " " + std::to_string(id);
+    }
+    if (const std::string *protocolName = enumName(etherTypeTable, type)) {
+      layer->setNs("::Ethernet::<" + *protocolName + ">");
+      summary = "[" + *protocolName + "] " + summary;
+    }
+    layer->setSummary(summary);
+
+    layer->setRange(range(offset));
+    layer->setPayload(slice(*payload, offset));
+    layer->addItem(
+        Item("Payload", ItemValue(slice(*payload, offset)), range(offset)));
+    layers->push_back(layer);
+  }
+};
+
+class IPv4 : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({"::Ethernet::<IPv4>"}, {});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *) const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>("::Ethernet::IPv4");
+    layer->setName("IPv4");
+    layer->setId("ipv4");
+
+    const uint8_t version = readUInt8(*payload, 0) >> 4;
+    layer->addItem(Item("Version", number(version), "0:1"));
+    layer->setAttr("version", number(version));
+
+    const uint8_t headerLength = readUInt8(*payload, 0) & 0b00001111;
+    layer->addItem(
+        Item("Internet Header Length", number(headerLength), "0:1"));
+    layer->setAttr("headerLength", number(headerLength));
+
+    const uint8_t type = readUInt8(*payload, 1);
+    layer->addItem(Item("Type of service", number(type), "1:2"));
+    layer->setAttr("type", number(type));
+
+    const uint16_t totalLength = readUInt16BE(*payload, 2);
+    layer->addItem(Item("Total Length", number(totalLength), "2:4"));
+    layer->setAttr("totalLength", number(totalLength));
+
+    const uint16_t id = readUInt16BE(*payload, 4);
+    layer->addItem(Item("Identification", number(id), "4:6"));
+    layer->setAttr("id", number(id));
+
+    const uint8_t flagBits = (readUInt8(*payload, 6) >> 5) & 0x7;
+    const bool reserved = flagBits & 0x1;
+    const bool dontFragment = flagBits & 0x2;
+    const bool moreFragments = flagBits & 0x4;
+    Item flags("Flags", flagsValue(ipv4FlagTable, flagBits), "6:7");
+    flags.addItem(Item("Reserved", ItemValue(reserved), "6:7"));
+    Item dontFragmentItem("Don't Fragment", ItemValue(dontFragment), "6:7");
+    dontFragmentItem.setAttr("_filterHint", text("ipv4.flags.DoNotFragment"));
+    flags.addItem(dontFragmentItem);
+    Item moreFragmentsItem("More Fragments", ItemValue(moreFragments), "6:7");
+    moreFragmentsItem.setAttr("_filterHint", text("ipv4.flags.MoreFragments"));
+    flags.addItem(moreFragmentsItem);
+    layer->addItem(flags);
+    layer->setAttr("flags",
+                   ItemValue(ItemValue::JSON,
+                             std::string("{\"DoNotFragment\":") +
+                                 (dontFragment ? "true" : "false") +
+                                 ",\"MoreFragments\":" +
+                                 (moreFragments ? "true" : "false") + "}"));
+
+    // The script masks a single byte here; kept for identical output.
+    const uint16_t fragmentOffset = readUInt8(*payload, 6) & 0b0001111111111111;
+    layer->addItem(Item("Fragment Offset", number(fragmentOffset), "6:8"));
+    layer->setAttr("fragmentOffset", number(fragmentOffset));
+
+    const uint8_t ttl = readUInt8(*payload, 8);
+    layer->addItem(Item("TTL", number(ttl), "8:9"));
+    layer->setAttr("ttl", number(ttl));
+
+    const uint8_t protocolNumber = readUInt8(*payload, 9);
+    const ItemValue protocol = enumValue(protocolTable, protocolNumber);
+    layer->addItem(Item("Protocol", protocol, "9:10"));
+    layer->setAttr("protocol", protocol);
+
+    const std::string *protocolName = enumName(protocolTable, protocolNumber);
+    if (protocolName) {
+      layer->setNs("::Ethernet::IPv4::<" + *protocolName + ">");
+    }
+
+    const uint16_t checksum = readUInt16BE(*payload, 10);
+    if (headerLength * 4u > payload->length())
+      throw std::out_of_range(outOfRange);
+    const bool checksumOk =
+        ByteOps::checksum(payload->data(), headerLength * 4, 0) == 0xffff;
+    Item checksumItem("Header Checksum", number(checksum), "10:12");
+    addChecksumStatus(&checksumItem, checksumOk, "10:12");
+    layer->addItem(checksumItem);
+    layer->setAttr("checksum", number(checksum));
+    layer->setAttr("checksumOk", ItemValue(checksumOk));
+
+    const ItemValue source(slice(*payload, 12, 16), "dripcap/ipv4/addr");
+    layer->addItem(Item("Source IP Address", source, "12:16"));
+    layer->setAttr("src", source);
+
+    const ItemValue destination(slice(*payload, 16, 20), "dripcap/ipv4/addr");
+    layer->addItem(Item("Destination IP Address", destination, "16:20"));
+    layer->setAttr("dst", destination);
+
+    // The script slices to the end of the frame while the range stops at
+    // the total length; both are kept for identical output.
+    layer->setRange("20:" + std::to_string(totalLength));
+    layer->setPayload(slice(*payload, 20));
+    layer->addItem(Item("Payload", ItemValue(slice(*payload, 20)),
+                        "20:" + std::to_string(totalLength)));
+
+    std::string summary =
+        formatAddress(source) + " -> " + formatAddress(destination);
+    if (protocolName) {
+      summary = "[" + *protocolName + "] " + summary;
+    }
+    layer->setSummary(summary);
+    layers->push_back(layer);
+  }
+};
+
+class IPv6 : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({"::Ethernet::<IPv6>"}, {});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *) const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>("::Ethernet::IPv6");
+    layer->setName("IPv6");
+    layer->setId("ipv6");
+
+    const uint8_t version = readUInt8(*payload, 0) >> 4;
+    layer->addItem(Item("Version", number(version), "0:1"));
+    layer->setAttr("version", number(version));
+
+    const uint8_t trafficClass =
+        ((readUInt8(*payload, 0) & 0b00001111) << 4) |
+        ((readUInt8(*payload, 1) & 0b11110000) >> 4);
+    layer->addItem(Item("Traffic Class", number(trafficClass), "0:2"));
+    layer->setAttr("trafficClass", number(trafficClass));
+
+    const uint32_t flowLevel = readUInt16BE(*payload, 2) |
+                               ((readUInt8(*payload, 1) & 0b00001111) << 16);
+    layer->addItem(Item("Flow Label", number(flowLevel), "1:4"));
+    layer->setAttr("flowLevel", number(flowLevel));
+
+    const uint16_t payloadLength = readUInt16BE(*payload, 4);
+    layer->addItem(Item("Payload Length", number(payloadLength), "4:6"));
+    layer->setAttr("payloadLength", number(payloadLength));
+
+    uint8_t nextHeader = readUInt8(*payload, 6);
+    std::string nextHeaderRange = "6:7";
+    layer->addItem(Item("Next Header", enumValue(protocolTable, nextHeader),
+                        nextHeaderRange));
+
+    const uint8_t hopLimit = readUInt8(*payload, 7);
+    layer->addItem(Item("Hop Limit", number(hopLimit), "7:8"));
+    layer->setAttr("hopLimit", number(hopLimit));
+
+    const ItemValue source(slice(*payload, 8, 24), "dripcap/ipv6/addr");
+    layer->addItem(Item("Source IP Address", source, "8:24"));
+    layer->setAttr("src", source);
+
+    const ItemValue destination(slice(*payload, 24, 40), "dripcap/ipv6/addr");
+    layer->addItem(Item("Destination IP Address", destination, "24:40"));
+    layer->setAttr("dst", destination);
+
+    size_t offset = 40;
+    // Hop-by-Hop Options and Destination Options.
+    while (nextHeader == 0 || nextHeader == 60) {
+      const uint8_t hdrExtLen = readUInt8(*payload, offset + 1);
+      const size_t extLen = (hdrExtLen + 1) * 8;
+      const char *name =
+          (nextHeader == 0) ? "Hop-by-Hop Options" : "Destination Options";
+
+      nextHeader = readUInt8(*payload, offset);
+      nextHeaderRange = range(offset, offset + 1);
+      Item item(name, ItemValue(), range(offset, offset + extLen));
+      item.addItem(Item("Next Header", enumValue(protocolTable, nextHeader),
+                        nextHeaderRange));
+      item.addItem(Item("Hdr Ext Len", number(hdrExtLen),
+                        range(offset + 1, offset + 2)));
+      item.addItem(Item("Options and Padding",
+                        ItemValue(slice(*payload, offset + 2, offset + extLen)),
+                        range(offset + 2, offset + extLen)));
+      layer->addItem(item);
+
+      offset += extLen;
+    }
+
+    const ItemValue protocol = enumValue(protocolTable, nextHeader);
+    const std::string *protocolName = enumName(protocolTable, nextHeader);
+    if (protocolName) {
+      layer->setNs("::Ethernet::IPv6::<" + *protocolName + ">");
+    }
+
+    layer->addItem(Item("Protocol", protocol, std::string()));
+    layer->setAttr("protocol", protocol);
+
+    layer->setRange(range(offset));
+    layer->setPayload(slice(*payload, offset));
+    layer->addItem(
+        Item("Payload", ItemValue(slice(*payload, offset)), range(offset)));
+
+    std::string summary =
+        formatAddress(source) + " -> " + formatAddress(destination);
+    if (protocolName) {
+      summary = "[" + *protocolName + "] " + summary;
+    }
+    layer->setSummary(summary);
+    layers->push_back(layer);
+  }
+};
+
+class UDP : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({}, {"::Ethernet::\\w+::<UDP>"});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *) const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>(
+        replaceFirst(parentLayer.ns(), "<UDP>", "UDP"));
+    layer->setName("UDP");
+    layer->setId("udp");
+
+    if (payload->length() < 8)
+      throw std::out_of_range(outOfRange);
+    const uint16_t source = readUInt16BE(*payload, 0);
+    const uint16_t destination = readUInt16BE(*payload, 2);
+    const uint16_t length = readUInt16BE(*payload, 4);
+    const uint16_t checksum = readUInt16BE(*payload, 6);
+
+    layer->addItem(Item("Source port", number(source), "0:2"));
+    layer->addItem(Item("Destination port", number(destination), "2:4"));
+
+    const Hosts host = hosts(parentLayer, source, destination);
+    layer->setAttr("src", text(host.src, host.type));
+    layer->setAttr("dst", text(host.dst, host.type));
+
+    layer->addItem(Item("Length", number(length), "4:6"));
+    layer->setAttr("length", number(length));
+
+    const int checksumOk =
+        (checksum == 0) ? -1
+                        : verifyChecksum(parentLayer, *payload, 17, length);
+    Item checksumItem("Checksum", number(checksum), "6:8");
+    addChecksumStatus(&checksumItem, checksumOk, "6:8");
+    layer->addItem(checksumItem);
+    layer->setAttr("checksum", number(checksum));
+    if (checksumOk >= 0) {
+      layer->setAttr("checksumOk", ItemValue(checksumOk > 0));
+    }
+
+    layer->setRange("8:" + std::to_string(length));
+    layer->setPayload(slice(*payload, 8, length));
+    layer->addItem(Item("Payload", ItemValue(slice(*payload, 8, length)),
+                        "8:" + std::to_string(length)));
+
+    layer->setSummary(host.src + " -> " + host.dst);
+    layers->push_back(layer);
+  }
+};
+
+class TCP : public NativeDissector {
+public:
+  DissectorNamespaces namespaces() const override {
+    return DissectorNamespaces({}, {"::Ethernet::\\w+::<TCP>"});
+  }
+
+  void analyze(const Packet &, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override {
+    const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+    auto layer = std::make_shared<Layer>(
+        replaceFirst(parentLayer.ns(), "<TCP>", "TCP"));
+    layer->setName("TCP");
+    layer->setId("tcp");
+
+    if (payload->length() < 20)
+      throw std::out_of_range(outOfRange);
+    const uint16_t source = readUInt16BE(*payload, 0);
+    const uint16_t destination = readUInt16BE(*payload, 2);
+    const uint32_t seq = readUInt32BE(*payload, 4);
+    const uint32_t ack = readUInt32BE(*payload, 8);
+    const uint16_t offsetFlags = readUInt16BE(*payload, 12);
+    const uint16_t window = readUInt16BE(*payload, 14);
+    const uint16_t checksum = readUInt16BE(*payload, 16);
+    const uint16_t urgent = readUInt16BE(*payload, 18);
+
+    layer->addItem(Item("Source port", number(source), "0:2"));
+    layer->addItem(Item("Destination port", number(destination), "2:4"));
+
+    const Hosts host = hosts(parentLayer, source, destination);
+    layer->setAttr("src", text(host.src, host.type));
+    layer->setAttr("dst", text(host.dst, host.type));
+
+    layer->addItem(Item("Sequence number", number(seq), "4:8"));
+    layer->setAttr("seq", number(seq));
+
+    layer->addItem(Item("Acknowledgment number", number(ack), "8:12"));
+    layer->setAttr("ack", number(ack));
+
+    const uint8_t dataOffset = offsetFlags >> 12;
+    layer->addItem(Item("Data offset", number(dataOffset), "12:13"));
+    layer->setAttr("dataOffset", number(dataOffset));
+
+    const uint16_t flagBits = offsetFlags & 0x1ff;
+    Item flags("Flags", flagsValue(tcpFlagTable, flagBits), std::string());
+    for (const auto &pair : tcpFlagTable) {
+      flags.addItem(Item(pair.first, ItemValue(bool(pair.second & flagBits)),
+                         pair.first == "NS" ? "12:13" : "13:14"));
+    }
+    layer->addItem(flags);
+
+    layer->addItem(Item("Window size", number(window), "14:16"));
+    layer->setAttr("window", number(window));
+
+    const int checksumOk = verifyChecksum(parentLayer, *payload, 6);
+    Item checksumItem("Checksum", number(checksum), "16:18");
+    addChecksumStatus(&checksumItem, checksumOk, "16:18");
+    layer->addItem(checksumItem);
+    layer->setAttr("checksum", number(checksum));
+    if (checksumOk >= 0) {
+      layer->setAttr("checksumOk", ItemValue(checksumOk > 0));
+    }
+
+    layer->addItem(Item("Urgent pointer", number(urgent), "18:20"));
+    layer->setAttr("urgent", number(urgent));
+
+    const size_t optionDataOffset = dataOffset * 4;
+    std::vector<Item> optionList;
+    std::string optionItems;
+    auto addOptionName = [&optionItems](const std::string &name) {
+      if (!optionItems.empty())
+        optionItems += ",";
+      optionItems += name;
+    };
+
+    size_t optionOffset = 20;
+    while (optionDataOffset > optionOffset) {
+      const size_t o = optionOffset;
+      if (o >= payload->length())
+        throw std::invalid_argument("unknown option");
+      switch (readUInt8(*payload, o)) {
+      case 0:
+        optionOffset = optionDataOffset;
+        break;
+
+      case 1:
+        optionList.push_back(Item("NOP", ItemValue(), range(o, o + 1)));
+        optionOffset++;
+        break;
+
+      case 2:
+        addOptionName("Maximum segment size");
+        optionList.push_back(Item("Maximum segment size",
+                            number(readUInt16BE(*payload, o + 2)),
+                            range(o, o + 4)));
+        optionOffset += 4;
+        break;
+
+      case 3:
+        addOptionName("Window scale");
+        optionList.push_back(Item("Window scale",
+                            o + 2 < payload->length()
+                                ? number(readUInt8(*payload, o + 2))
+                                : ItemValue(),
+                            range(o, o + 3)));
+        optionOffset += 3;
+        break;
+
+      case 4:
+        addOptionName("Selective ACK permitted");
+        optionList.push_back(
+            Item("Selective ACK permitted", ItemValue(), range(o, o + 2)));
+        optionOffset += 2;
+        break;
+
+      case 5: {
+        const uint8_t length = readUInt8(*payload, o + 1);
+        if (length < 2)
+          throw std::invalid_argument("invalid option length");
+        addOptionName("Selective ACK");
+        optionList.push_back(Item("Selective ACK",
+                            ItemValue(slice(*payload, o + 2, o + length)),
+                            std::string()));
+        optionOffset += length;
+      } break;
+
+      case 8: {
+        // The script reads the same word twice; kept for identical output.
+        const uint32_t mt = readUInt32BE(*payload, o + 2);
+        const uint32_t et = readUInt32BE(*payload, o + 2);
+        addOptionName("Timestamps");
+        Item timestamps("Timestamps",
+                        text(std::to_string(mt) + " - " + std::to_string(et)),
+                        range(o, o + 10));
+        timestamps.addItem(
+            Item("My timestamp", number(mt), range(o + 2, o + 6)));
+        timestamps.addItem(
+            Item("Echo reply timestamp", number(et), range(o + 6, o + 10)));
+        optionList.push_back(timestamps);
+        optionOffset += 10;
+      } break;
+
+      default:
+        throw std::invalid_argument("unknown option");
+      }
+    }
+
+    Item option("Options", text(optionItems), range(20, optionDataOffset));
+    for (const Item &item : optionList) {
+      option.addItem(item);
+    }
+    layer->addItem(option);
+
+    layer->setRange(range(optionDataOffset));
+    layer->setPayload(slice(*payload, optionDataOffset));
+    layer->addItem(Item("Payload",
+                        ItemValue(slice(*payload, optionDataOffset)),
+                        range(optionDataOffset)));
+
+    layer->setSummary(host.src + " -> " + host.dst + " seq:" +
+                      std::to_string(seq) + " ack:" + std::to_string(ack));
+    layers->push_back(layer);
+
+    // The chunk is bound to the parent layer, as the script leaves it to
+    // the dissector thread to fill in.
+    std::unique_ptr<StreamChunk> chunk(
+        new StreamChunk(parentLayer.ns(), host.src + "/" + host.dst));
+    chunk->setAttr("payload", ItemValue(slice(*payload, optionDataOffset)));
+    chunk->setAttr("seq", number(seq));
+    if ((flagBits & 0x1) && (flagBits & 0x10)) {
+      chunk->setEnd(true);
+    }
+    streams->push_back(std::move(chunk));
+  }
+};
+
+template <class T> NativeDissector::Factory factory() {
+  return [](const std::string &) {
+    return std::unique_ptr<NativeDissector>(new T());
+  };
+}
+}
+
+void BuiltinDissectors::registerAll(
+    std::unordered_map<std::string, NativeDissector::Factory> *factories) {
+  (*factories)["ethernet"] = factory<Ethernet>();
+  (*factories)["vlan"] = factory<VLAN>();
+  (*factories)["ipv4"] = factory<IPv4>();
+  (*factories)["ipv6"] = factory<IPv6>();
+  (*factories)["tcp"] = factory<TCP>();
+  (*factories)["udp"] = factory<UDP>();
+}
@@ -0,0 +1,15 @@
+#ifndef BUILTIN_DISSECTORS_HPP
+#define BUILTIN_DISSECTORS_HPP
+
+#include "native_dissector.hpp"
+#include <string>
+#include <unordered_map>
+
+// Native versions of the core packages in packages/dissector, registered
+// as "ethernet", "vlan", "ipv4", "ipv6", "tcp" and "udp".
+namespace BuiltinDissectors {
+void registerAll(
+    std::unordered_map<std::string, NativeDissector::Factory> *factories);
+}
+
+#endif
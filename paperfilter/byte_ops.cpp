@@ -0,0 +1,295 @@
+#include "byte_ops.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BYTE_OPS_X86_64
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+const char hexDigits[] = "0123456789abcdef";
+
+int scalarSearch(const char *str, size_t strlen, const char *sub,
+                 size_t sublen, size_t from) {
+  while (from + sublen <= strlen) {
+    const void *found =
+        std::memchr(str + from, sub[0], strlen - sublen + 1 - from);
+    if (!found)
+      return -1;
+    from = static_cast<const char *>(found) - str;
+    if (std::memcmp(str + from + 1, sub + 1, sublen - 1) == 0)
+      return static_cast<int>(from);
+    ++from;
+  }
+  return -1;
+}
+
+uint32_t fold(uint64_t sum) {
+  while (sum >> 16) {
+    sum = (sum & 0xffff) + (sum >> 16);
+  }
+  return static_cast<uint32_t>(sum);
+}
+
+// Sums 16-bit words in host order; RFC 1071 allows byte swapping the
+// folded result afterwards instead of swapping every word.
+uint64_t scalarSum(const char *data, size_t length) {
+  uint64_t sum = 0;
+  size_t i = 0;
+  for (; i + 4 <= length; i += 4) {
+    uint32_t word;
+    std::memcpy(&word, data + i, 4);
+    sum += word;
+  }
+  for (; i + 2 <= length; i += 2) {
+    uint16_t word;
+    std::memcpy(&word, data + i, 2);
+    sum += word;
+  }
+  if (i < length) {
+    const uint8_t last = static_cast<uint8_t>(data[i]);
+    const uint16_t word = 1;
+    bool littleEndian = *reinterpret_cast<const uint8_t *>(&word) == 1;
+    sum += littleEndian ? last : static_cast<uint32_t>(last) << 8;
+  }
+  return sum;
+}
+
+int scalarHexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+#ifdef BYTE_OPS_X86_64
+int countTrailingZeros(uint32_t mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+bool hasAvx2() {
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuid(info, 1);
+  bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!osxsave || (_xgetbv(0) & 0x6) != 0x6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// Compares the first and last bytes of the needle at 16 candidate offsets at
+// once and only verifies the offsets where both match.
+int sse2Search(const char *str, size_t strlen, const char *sub,
+               size_t sublen) {
+  const __m128i first = _mm_set1_epi8(sub[0]);
+  const __m128i last = _mm_set1_epi8(sub[sublen - 1]);
+  size_t i = 0;
+  for (; i + sublen - 1 + 16 <= strlen; i += 16) {
+    const __m128i blockFirst =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i));
+    const __m128i blockLast = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(str + i + sublen - 1));
+    uint32_t mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+    while (mask) {
+      size_t offset = i + countTrailingZeros(mask);
+      if (std::memcmp(str + offset + 1, sub + 1, sublen - 2) == 0)
+        return static_cast<int>(offset);
+      mask &= mask - 1;
+    }
+  }
+  return scalarSearch(str, strlen, sub, sublen, i);
+}
+
+TARGET_AVX2 int avx2Search(const char *str, size_t strlen, const char *sub,
+                           size_t sublen) {
+  const __m256i first = _mm256_set1_epi8(sub[0]);
+  const __m256i last = _mm256_set1_epi8(sub[sublen - 1]);
+  size_t i = 0;
+  for (; i + sublen - 1 + 32 <= strlen; i += 32) {
+    const __m256i blockFirst =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(str + i));
+    const __m256i blockLast = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(str + i + sublen - 1));
+    uint32_t mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst),
+                         _mm256_cmpeq_epi8(last, blockLast)));
+    while (mask) {
+      size_t offset = i + countTrailingZeros(mask);
+      if (std::memcmp(str + offset + 1, sub + 1, sublen - 2) == 0)
+        return static_cast<int>(offset);
+      mask &= mask - 1;
+    }
+  }
+  int found = sse2Search(str + i, strlen - i, sub, sublen);
+  return found < 0 ? -1 : static_cast<int>(i) + found;
+}
+
+// Widens 16-bit words into 32-bit lanes; each lane absorbs at most 2 words
+// per block, so the accumulator is flushed well before it can overflow.
+uint64_t sse2Sum(const char *data, size_t length, size_t *consumed) {
+  const __m128i zero = _mm_setzero_si128();
+  uint64_t sum = 0;
+  size_t i = 0;
+  while (i + 16 <= length) {
+    __m128i acc = _mm_setzero_si128();
+    for (int n = 0; n < 16384 && i + 16 <= length; ++n, i += 16) {
+      const __m128i block =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(block, zero));
+      acc = _mm_add_epi32(acc, _mm_unpackhi_epi16(block, zero));
+    }
+    uint32_t lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    sum += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+  }
+  *consumed = i;
+  return sum;
+}
+
+typedef int (*SearchFunc)(const char *, size_t, const char *, size_t);
+
+SearchFunc selectSearch() { return hasAvx2() ? avx2Search : sse2Search; }
+
+// Maps 16 nibbles to their lowercase hex digits.
+__m128i hexNibbles(__m128i nibbles) {
+  const __m128i nine = _mm_set1_epi8(9);
+  const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine),
+                                        _mm_set1_epi8('a' - '0' - 10));
+  return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+// Maps 16 hex digits to their values and sets |invalid| on other bytes.
+__m128i hexValues(__m128i chars, __m128i *invalid) {
+  const __m128i lower = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+  const __m128i isDigit =
+      _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                    _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+  const __m128i isAlpha =
+      _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)),
+                    _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+  const __m128i digit = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+  const __m128i alpha = _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10));
+  *invalid = _mm_or_si128(*invalid,
+                          _mm_andnot_si128(_mm_or_si128(isDigit, isAlpha),
+                                           _mm_set1_epi8(-1)));
+  return _mm_or_si128(_mm_and_si128(isDigit, digit),
+                      _mm_and_si128(isAlpha, alpha));
+}
+#endif
+}
+
+namespace ByteOps {
+int search(const char *str, size_t strlen, const char *sub, size_t sublen) {
+  if (sublen > strlen)
+    return -1;
+  if (sublen == 0)
+    return 0;
+  if (sublen == 1) {
+    const void *found = std::memchr(str, sub[0], strlen);
+    return found ? static_cast<int>(static_cast<const char *>(found) - str)
+                 : -1;
+  }
+#ifdef BYTE_OPS_X86_64
+  static const SearchFunc func = selectSearch();
+  return func(str, strlen, sub, sublen);
+#else
+  return scalarSearch(str, strlen, sub, sublen, 0);
+#endif
+}
+
+uint16_t checksum(const char *data, size_t length, uint32_t initial) {
+  uint64_t sum = 0;
+  size_t i = 0;
+#ifdef BYTE_OPS_X86_64
+  sum = sse2Sum(data, length, &i);
+#endif
+  sum += scalarSum(data + i, length - i);
+  uint32_t folded = fold(sum);
+  const uint16_t word = 1;
+  if (*reinterpret_cast<const uint8_t *>(&word) == 1)
+    folded = ((folded & 0xff) << 8) | (folded >> 8);
+  return static_cast<uint16_t>(fold(static_cast<uint64_t>(folded) + initial));
+}
+
+void hexEncode(const char *data, size_t length, char *out) {
+  size_t i = 0;
+#ifdef BYTE_OPS_X86_64
+  const __m128i mask = _mm_set1_epi8(0x0f);
+  for (; i + 16 <= length; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+    const __m128i high =
+        hexNibbles(_mm_and_si128(_mm_srli_epi16(bytes, 4), mask));
+    const __m128i low = hexNibbles(_mm_and_si128(bytes, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2),
+                     _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16),
+                     _mm_unpackhi_epi8(high, low));
+  }
+#endif
+  for (; i < length; ++i) {
+    uint8_t byte = static_cast<uint8_t>(data[i]);
+    out[i * 2] = hexDigits[byte >> 4];
+    out[i * 2 + 1] = hexDigits[byte & 0x0f];
+  }
+}
+
+bool hexDecode(const char *str, size_t length, char *out) {
+  size_t i = 0;
+#ifdef BYTE_OPS_X86_64
+  __m128i invalid = _mm_setzero_si128();
+  for (; i + 32 <= length; i += 32) {
+    const __m128i first = hexValues(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i)), &invalid);
+    const __m128i second = hexValues(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(str + i + 16)),
+        &invalid);
+    // Each 16-bit lane holds (low digit << 8 | high digit).
+    const __m128i lowByte = _mm_set1_epi16(0x00ff);
+    const __m128i packedFirst =
+        _mm_or_si128(_mm_slli_epi16(_mm_and_si128(first, lowByte), 4),
+                     _mm_srli_epi16(first, 8));
+    const __m128i packedSecond =
+        _mm_or_si128(_mm_slli_epi16(_mm_and_si128(second, lowByte), 4),
+                     _mm_srli_epi16(second, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i / 2),
+                     _mm_packus_epi16(packedFirst, packedSecond));
+  }
+  if (_mm_movemask_epi8(invalid))
+    return false;
+#endif
+  for (; i + 1 < length; i += 2) {
+    int high = scalarHexValue(str[i]);
+    int low = scalarHexValue(str[i + 1]);
+    if (high < 0 || low < 0)
+      return false;
+    out[i / 2] = static_cast<char>((high << 4) | low);
+  }
+  return true;
+}
+}
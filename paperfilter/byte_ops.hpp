@@ -0,0 +1,22 @@
+#ifndef BYTE_OPS_HPP
+#define BYTE_OPS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ByteOps {
+// Returns the offset of the first occurrence of |sub| in |str| or -1.
+int search(const char *str, size_t strlen, const char *sub, size_t sublen);
+
+// Folds |initial| and the 16-bit big-endian one's complement sum of |data|
+// into a 16-bit sum. A valid Internet checksum region sums to 0xffff.
+uint16_t checksum(const char *data, size_t length, uint32_t initial);
+
+// Writes 2 * |length| lowercase hex digits to |out|.
+void hexEncode(const char *data, size_t length, char *out);
+
+// Writes |length| / 2 bytes to |out|; returns false on a non-hex digit.
+bool hexDecode(const char *str, size_t length, char *out);
+}
+
+#endif
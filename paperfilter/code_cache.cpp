@@ -0,0 +1,257 @@
+#include "code_cache.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <uv.h>
+#include <vector>
+#include <v8pp/convert.hpp>
+
+namespace {
+// Recently used entries are kept in memory; the directory is pruned to
+// |maxDiskBytes|, oldest files first.
+const size_t maxEntries = 128;
+const uint64_t maxDiskBytes = 64 * 1024 * 1024;
+
+typedef std::pair<uint64_t, std::shared_ptr<const std::string>> Entry;
+
+struct CacheFile {
+  uint64_t mtime;
+  uint64_t size;
+  std::string path;
+};
+
+std::mutex mutex;
+std::mutex pruneMutex;
+std::string directory;
+std::list<Entry> recent;
+std::unordered_map<uint64_t, std::list<Entry>::iterator> entries;
+
+uint64_t fnv1a(uint64_t hash, const std::string &str) {
+  for (char c : str) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Cached data is only valid for the V8 build that produced it, so the
+// version is part of the key.
+uint64_t cacheKey(const std::string &source, const std::string &resourceName) {
+  uint64_t hash = 14695981039346656037ull;
+  hash = fnv1a(hash, v8::V8::GetVersion());
+  hash = fnv1a(hash, resourceName);
+  hash = fnv1a(hash, std::string(1, '\0'));
+  return fnv1a(hash, source);
+}
+
+// Files of other V8 builds can never be used again, so their names start
+// with a hash of the version and are removed when the directory is pruned.
+std::string versionPrefix() {
+  std::stringstream stream;
+  stream << std::hex << fnv1a(14695981039346656037ull, v8::V8::GetVersion())
+         << "-";
+  return stream.str();
+}
+
+std::string cachePath(const std::string &dir, uint64_t key) {
+  std::stringstream stream;
+  stream << dir << "/" << versionPrefix() << std::hex << key << ".cache";
+  return stream.str();
+}
+
+bool endsWith(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Called with |mutex| held.
+std::shared_ptr<const std::string> find(uint64_t key) {
+  const auto it = entries.find(key);
+  if (it == entries.end())
+    return nullptr;
+  recent.splice(recent.begin(), recent, it->second);
+  return it->second->second;
+}
+
+// Called with |mutex| held. Returns false if |key| is already cached.
+bool insert(uint64_t key, const std::shared_ptr<const std::string> &data) {
+  if (entries.count(key))
+    return false;
+  recent.emplace_front(key, data);
+  entries[key] = recent.begin();
+  while (recent.size() > maxEntries) {
+    entries.erase(recent.back().first);
+    recent.pop_back();
+  }
+  return true;
+}
+
+void prune(const std::string &dir) {
+  std::lock_guard<std::mutex> lock(pruneMutex);
+  uv_loop_t *loop = uv_default_loop();
+  uv_fs_t req;
+  if (uv_fs_scandir(loop, &req, dir.c_str(), 0, nullptr) < 0) {
+    uv_fs_req_cleanup(&req);
+    return;
+  }
+  const std::string &prefix = versionPrefix();
+  std::vector<std::string> stale;
+  std::vector<CacheFile> files;
+  uv_dirent_t ent;
+  while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+    const std::string name = ent.name;
+    if (!endsWith(name, ".cache"))
+      continue;
+    const std::string &path = dir + "/" + name;
+    if (name.compare(0, prefix.size(), prefix) != 0) {
+      stale.push_back(path);
+      continue;
+    }
+    uv_fs_t stat;
+    if (uv_fs_stat(loop, &stat, path.c_str(), nullptr) == 0) {
+      files.push_back(CacheFile{
+          static_cast<uint64_t>(stat.statbuf.st_mtim.tv_sec),
+          stat.statbuf.st_size, path});
+    }
+    uv_fs_req_cleanup(&stat);
+  }
+  uv_fs_req_cleanup(&req);
+
+  std::sort(files.begin(), files.end(),
+            [](const CacheFile &a, const CacheFile &b) {
+              return a.mtime > b.mtime;
+            });
+  uint64_t total = 0;
+  for (const CacheFile &file : files) {
+    total += file.size;
+    if (total > maxDiskBytes)
+      stale.push_back(file.path);
+  }
+  for (const std::string &path : stale) {
+    std::remove(path.c_str());
+  }
+}
+
+std::shared_ptr<const std::string> load(uint64_t key) {
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (const std::shared_ptr<const std::string> &data = find(key))
+      return data;
+    dir = directory;
+  }
+  if (dir.empty())
+    return nullptr;
+
+  std::ifstream ifs(cachePath(dir, key), std::ios::binary);
+  if (!ifs)
+    return nullptr;
+  std::stringstream stream;
+  stream << ifs.rdbuf();
+  auto data = std::make_shared<const std::string>(stream.str());
+  if (data->empty())
+    return nullptr;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!insert(key, data))
+    return find(key);
+  return data;
+}
+
+void store(uint64_t key, const std::shared_ptr<const std::string> &data) {
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!insert(key, data))
+      return;
+    dir = directory;
+  }
+  if (dir.empty())
+    return;
+
+  // Write to a private file first so that concurrent readers never see a
+  // partial entry.
+  const std::string &path = cachePath(dir, key);
+  std::stringstream tmp;
+  tmp << path << "." << std::hex << reinterpret_cast<uintptr_t>(data.get());
+  {
+    std::ofstream ofs(tmp.str(), std::ios::binary | std::ios::trunc);
+    if (!ofs)
+      return;
+    ofs.write(data->data(), data->size());
+    if (!ofs) {
+      ofs.close();
+      std::remove(tmp.str().c_str());
+      return;
+    }
+  }
+  std::remove(path.c_str());
+  if (std::rename(tmp.str().c_str(), path.c_str()) != 0)
+    std::remove(tmp.str().c_str());
+  prune(dir);
+}
+
+void drop(uint64_t key) {
+  std::string dir;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = entries.find(key);
+    if (it != entries.end()) {
+      recent.erase(it->second);
+      entries.erase(it);
+    }
+    dir = directory;
+  }
+  if (!dir.empty())
+    std::remove(cachePath(dir, key).c_str());
+}
+}
+
+void CodeCache::setDirectory(const std::string &dir) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (directory == dir)
+      return;
+    directory = dir;
+  }
+  prune(dir);
+}
+
+v8::MaybeLocal<v8::Script>
+CodeCache::compile(v8::Isolate *isolate, const std::string &source,
+                   const std::string &resourceName) {
+  const uint64_t key = cacheKey(source, resourceName);
+  const std::shared_ptr<const std::string> &cached = load(key);
+
+  v8::ScriptOrigin origin(v8pp::to_v8(isolate, resourceName));
+  v8::ScriptCompiler::CachedData *data = nullptr;
+  if (cached) {
+    data = new v8::ScriptCompiler::CachedData(
+        reinterpret_cast<const uint8_t *>(cached->data()), cached->size());
+  }
+  v8::ScriptCompiler::Source src(v8pp::to_v8(isolate, source), origin, data);
+  v8::MaybeLocal<v8::Script> script = v8::ScriptCompiler::Compile(
+      isolate->GetCurrentContext(), &src,
+      cached ? v8::ScriptCompiler::kConsumeCodeCache
+             : v8::ScriptCompiler::kProduceCodeCache);
+  if (script.IsEmpty())
+    return script;
+
+  const v8::ScriptCompiler::CachedData *result = src.GetCachedData();
+  if (cached) {
+    if (result && result->rejected)
+      drop(key);
+  } else if (result && result->length > 0) {
+    store(key, std::make_shared<const std::string>(
+                   reinterpret_cast<const char *>(result->data),
+                   result->length));
+  }
+  return script;
+}
@@ -0,0 +1,15 @@
+#ifndef CODE_CACHE_HPP
+#define CODE_CACHE_HPP
+
+#include <string>
+#include <v8.h>
+
+class CodeCache {
+public:
+  static void setDirectory(const std::string &dir);
+  static v8::MaybeLocal<v8::Script> compile(v8::Isolate *isolate,
+                                            const std::string &source,
+                                            const std::string &resourceName);
+};
+
+#endif
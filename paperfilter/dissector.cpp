@@ -1,8 +1,60 @@
 #include "dissector.hpp"
+#include <algorithm>
+#include <node_buffer.h>
 #include <v8pp/object.hpp>
 
 Dissector::Dissector(v8::Local<v8::Object> option) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  v8pp::get_option(isolate, option, "script", script);
+  v8::Local<v8::Value> value;
+  if (v8pp::get_option(isolate, option, "script", value) &&
+      node::Buffer::HasInstance(value)) {
+    script.assign(node::Buffer::Data(value), node::Buffer::Length(value));
+  } else {
+    v8pp::get_option(isolate, option, "script", script);
+  }
   v8pp::get_option(isolate, option, "resourceName", resourceName);
+  v8pp::get_option(isolate, option, "native", native);
+}
+
+Dissector::Dissector(const std::string &script, const std::string &resourceName,
+                     const std::string &native)
+    : script(script), resourceName(resourceName), native(native) {}
+
+DissectorNamespaces::DissectorNamespaces() {}
+
+DissectorNamespaces::DissectorNamespaces(v8::Local<v8::Object> func) {
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  v8::Local<v8::Array> array;
+  if (!v8pp::get_option(isolate, func, "namespaces", array))
+    return;
+  for (uint32_t i = 0; i < array->Length(); ++i) {
+    v8::Local<v8::Value> ns = array->Get(i);
+    if (ns->IsString()) {
+      namespaces.push_back(v8pp::from_v8<std::string>(isolate, ns, ""));
+    } else if (ns->IsRegExp()) {
+      const std::string &source = v8pp::from_v8<std::string>(
+          isolate, ns.As<v8::RegExp>()->GetSource(), "");
+      regexNamespaces.push_back(std::regex(source));
+      regexSources.push_back(source);
+    }
+  }
+}
+
+DissectorNamespaces::DissectorNamespaces(
+    const std::vector<std::string> &namespaces,
+    const std::vector<std::string> &regexSources)
+    : namespaces(namespaces), regexSources(regexSources) {
+  for (const std::string &source : regexSources) {
+    regexNamespaces.push_back(std::regex(source));
+  }
+}
+
+bool DissectorNamespaces::match(const std::string &ns) const {
+  if (std::find(namespaces.begin(), namespaces.end(), ns) != namespaces.end())
+    return true;
+  for (const std::regex &regex : regexNamespaces) {
+    if (std::regex_match(ns, regex))
+      return true;
+  }
+  return false;
 }
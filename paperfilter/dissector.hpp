@@ -9,10 +9,29 @@
 struct Dissector {
 public:
   explicit Dissector(v8::Local<v8::Object> option);
+  Dissector(const std::string &script, const std::string &resourceName,
+            const std::string &native = std::string());
 
 public:
+  // Script source, a field table, or the bytes of a WebAssembly module.
   std::string script;
   std::string resourceName;
+  // Name of a registered NativeDissector used instead of |script|.
+  std::string native;
+};
+
+struct DissectorNamespaces {
+public:
+  DissectorNamespaces();
+  explicit DissectorNamespaces(v8::Local<v8::Object> func);
+  DissectorNamespaces(const std::vector<std::string> &namespaces,
+                      const std::vector<std::string> &regexSources);
+  bool match(const std::string &ns) const;
+
+public:
+  std::vector<std::string> namespaces;
+  std::vector<std::regex> regexNamespaces;
+  std::vector<std::string> regexSources;
 };
 
 #endif
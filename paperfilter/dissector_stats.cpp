@@ -0,0 +1,49 @@
+#include "dissector_stats.hpp"
+#include <algorithm>
+
+namespace {
+void add(std::atomic<uint64_t> *counter, uint64_t value) {
+  counter->store(counter->load(std::memory_order_relaxed) + value,
+                 std::memory_order_relaxed);
+}
+}
+
+DissectorCounters::DissectorCounters()
+    : calls(0), totalNsec(0), maxNsec(0), errors(0), layers(0), chunks(0) {}
+
+void DissectorCounters::record(uint64_t nsec, bool error, size_t layers,
+                               size_t chunks) {
+  add(&calls, 1);
+  add(&totalNsec, nsec);
+  if (nsec > maxNsec.load(std::memory_order_relaxed)) {
+    maxNsec.store(nsec, std::memory_order_relaxed);
+  }
+  if (error) {
+    add(&errors, 1);
+  }
+  add(&this->layers, layers);
+  add(&this->chunks, chunks);
+}
+
+DissectorStats::DissectorStats()
+    : thread(0), calls(0), totalNsec(0), maxNsec(0), errors(0), layers(0),
+      chunks(0) {}
+
+DissectorStats::DissectorStats(const std::string &resourceName, size_t thread,
+                               const DissectorCounters &counters)
+    : resourceName(resourceName), thread(thread),
+      calls(counters.calls.load(std::memory_order_relaxed)),
+      totalNsec(counters.totalNsec.load(std::memory_order_relaxed)),
+      maxNsec(counters.maxNsec.load(std::memory_order_relaxed)),
+      errors(counters.errors.load(std::memory_order_relaxed)),
+      layers(counters.layers.load(std::memory_order_relaxed)),
+      chunks(counters.chunks.load(std::memory_order_relaxed)) {}
+
+void DissectorStats::merge(const DissectorStats &other) {
+  calls += other.calls;
+  totalNsec += other.totalNsec;
+  maxNsec = std::max(maxNsec, other.maxNsec);
+  errors += other.errors;
+  layers += other.layers;
+  chunks += other.chunks;
+}
@@ -0,0 +1,56 @@
+#ifndef DISSECTOR_STATS_HPP
+#define DISSECTOR_STATS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Profiling counters for one dissector on one thread. Only that thread
+// writes them, so updates are plain relaxed stores and readers can take a
+// snapshot at any time without stopping it.
+class DissectorCounters {
+public:
+  DissectorCounters();
+  DissectorCounters(const DissectorCounters &) = delete;
+  DissectorCounters &operator=(const DissectorCounters &) = delete;
+  void record(uint64_t nsec, bool error, size_t layers, size_t chunks);
+
+public:
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> totalNsec;
+  std::atomic<uint64_t> maxNsec;
+  std::atomic<uint64_t> errors;
+  std::atomic<uint64_t> layers;
+  std::atomic<uint64_t> chunks;
+};
+
+// Timeouts of one dissector across all threads. It is replaced when the
+// script changes, which enables the dissector again.
+struct DissectorHealth {
+  DissectorHealth() : timeouts(0), disabled(false) {}
+
+  std::string script;
+  std::string native;
+  std::atomic<int> timeouts;
+  std::atomic<bool> disabled;
+};
+
+struct DissectorStats {
+  DissectorStats();
+  DissectorStats(const std::string &resourceName, size_t thread,
+                 const DissectorCounters &counters);
+  // Sums the counters of |other| and keeps the larger maximum.
+  void merge(const DissectorStats &other);
+
+  std::string resourceName;
+  size_t thread;
+  uint64_t calls;
+  uint64_t totalNsec;
+  uint64_t maxNsec;
+  uint64_t errors;
+  uint64_t layers;
+  uint64_t chunks;
+};
+
+#endif
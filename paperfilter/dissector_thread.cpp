@@ -1,11 +1,18 @@
 #include "dissector_thread.hpp"
 #include "packet_dispatcher.hpp"
 #include "log_message.hpp"
+#include "code_cache.hpp"
 #include "console.hpp"
+#include "item_value.hpp"
 #include "layer.hpp"
+#include "namespace_table.hpp"
+#include "native_dissector.hpp"
 #include "packet.hpp"
 #include "paper_context.hpp"
 #include "stream_chunk.hpp"
+#include "wasm_dissector.hpp"
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
 #include <nan.h>
 #include <thread>
@@ -17,6 +24,8 @@
 using namespace v8;
 
 namespace {
+const size_t maxBatchSize = 32;
+
 class ArrayBufferAllocator : public v8::ArrayBuffer::Allocator {
 public:
   ArrayBufferAllocator() {}
@@ -27,32 +36,70 @@ public:
   virtual void Free(void *data, size_t) { free(data); }
 };
 
+uint64_t nsecSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void attachLayers(
+    const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers,
+    const std::shared_ptr<Packet> &pkt, std::unordered_set<std::string> *ns) {
+  for (const auto &pair : layers) {
+    ns->insert(pair.first);
+    pair.second->setPacket(pkt);
+    attachLayers(pair.second->layers(), pkt, ns);
+  }
+}
+
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
+  std::string script;
+  std::string nativeName;
+  std::string resourceName;
+  DissectorNamespaces namespaces;
   v8::UniquePersistent<v8::Function> func;
+  v8::UniquePersistent<v8::Function> analyze;
+  std::unique_ptr<NativeDissector> native;
+  std::shared_ptr<DissectorCounters> counters;
+  std::shared_ptr<DissectorHealth> health;
 };
 }
 
 class DissectorThread::Private {
 public:
-  Private(const std::shared_ptr<DissectorSharedContext> &ctx);
+  Private(const std::shared_ptr<DissectorSharedContext> &ctx, size_t index);
   ~Private();
-  const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-          *nsMap);
+  void load(v8::Isolate *isolate, const v8::TryCatch &try_catch,
+            const std::vector<Dissector> &scripts,
+            std::unordered_map<std::string, DissectorFunc> *dissectors);
+  std::vector<std::unique_ptr<Packet>> take();
+  void requeue(std::vector<std::unique_ptr<Packet>> batch);
+  std::shared_ptr<DissectorCounters> counters(const std::string &name);
+  std::shared_ptr<DissectorHealth> health(const Dissector &diss);
+  void scriptError(const DissectorFunc &diss, const v8::TryCatch &try_catch,
+                   const Packet &pkt, Layer *layer);
+  void timedOut(const DissectorFunc &diss, const Packet &pkt, Layer *layer);
+  std::string loadTimeoutMessage() const;
+  void analyzeNative(
+      const DissectorFunc &diss, const std::shared_ptr<Packet> &pkt,
+      const std::shared_ptr<Layer> &parentLayer,
+      std::unordered_map<std::string, std::shared_ptr<Layer>> *nextLayers,
+      std::vector<std::unique_ptr<StreamChunk>> *streams);
+  std::shared_ptr<const NamespaceTable>
+  namespaceTable(uint32_t generation,
+                 const std::unordered_map<std::string, DissectorFunc> &funcs);
 
 public:
   std::thread thread;
   std::shared_ptr<DissectorSharedContext> ctx;
+  size_t index;
+  std::shared_ptr<Watchdog::Slot> slot;
   bool closed = false;
 };
 
 DissectorThread::Private::Private(
-    const std::shared_ptr<DissectorSharedContext> &ctx)
-    : ctx(ctx) {
+    const std::shared_ptr<DissectorSharedContext> &ctx, size_t index)
+    : ctx(ctx), index(index) {
   thread = std::thread([this]() {
     DissectorSharedContext &ctx = *this->ctx;
     v8::Isolate::CreateParams create_params;
@@ -70,6 +117,7 @@ DissectorThread::Private::Private(
       v8::Context::Scope context_scope(context);
       v8::TryCatch try_catch;
       PaperContext::init(isolate);
+      slot = ctx.watchdog->watch(isolate);
 
       v8::Local<v8::Object> console =
           v8pp::class_<Console>::create_object(isolate, ctx.logCb, "dissector");
@@ -77,124 +125,168 @@ DissectorThread::Private::Private(
           v8pp::to_v8(isolate, "console"), console);
 
       std::unordered_map<std::string, DissectorFunc> dissectors;
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
-
-      for (const Dissector &diss : ctx.dissectors) {
-        v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
-        context->Global()->Set(v8::String::NewFromUtf8(isolate, "module"),
-                               moduleObj);
-
-        v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
-        if (!script.IsEmpty()) {
-          Nan::RunScript(script.ToLocalChecked());
-          v8::Local<v8::Value> result =
-              moduleObj->Get(v8::String::NewFromUtf8(isolate, "exports"));
-
-          if (!result.IsEmpty() && result->IsFunction()) {
-            func = result.As<v8::Function>();
-          }
-        }
-        if (func.IsEmpty()) {
-          if (ctx.logCb) {
-            ctx.logCb(
-                LogMessage::fromMessage(try_catch.Message(), "dissector"));
-          }
-        } else {
-          v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
-
-          if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
-              if (ns->IsString()) {
-                stringNamespaces.push_back(
-                    v8pp::from_v8<std::string>(isolate, ns, ""));
-              } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
-              }
-            }
-          }
-
-          dissectors[diss.resourceName] = {
-              stringNamespaces, regexNamespaces,
-              v8::UniquePersistent<v8::Function>(isolate, func)};
-        }
-      }
+      std::shared_ptr<const NamespaceTable> table;
+      std::vector<const DissectorFunc *> funcs;
+      uint32_t generation = 0;
 
       while (true) {
         std::unique_lock<std::mutex> lock(ctx.mutex);
-        ctx.cond.wait(lock,
-                      [this, &ctx] { return !ctx.queue.empty() || closed; });
+        ++ctx.idle;
+        ctx.cond.wait(lock, [this, &ctx, generation] {
+          return ctx.pending > 0 || closed || generation != ctx.generation;
+        });
+        --ctx.idle;
         if (closed)
           break;
 
-        std::shared_ptr<Packet> pkt = std::move(ctx.queue.front());
-        ctx.queue.pop();
+        if (generation != ctx.generation) {
+          generation = ctx.generation;
+          const std::vector<Dissector> scripts = ctx.dissectors;
+          lock.unlock();
+
+          load(isolate, try_catch, scripts, &dissectors);
+
+          lock.lock();
+          if (generation == ctx.generation) {
+            for (const auto &pair : dissectors) {
+              ctx.namespaces[pair.first] = pair.second.namespaces;
+            }
+          }
+          table = namespaceTable(generation, dissectors);
+          funcs.clear();
+          for (const std::string &name : table->names()) {
+            const auto it = dissectors.find(name);
+            funcs.push_back(it != dissectors.end() ? &it->second : nullptr);
+          }
+          ctx.loadedGeneration = std::max(ctx.loadedGeneration, generation);
+          ctx.loadCond.notify_all();
+          continue;
+        }
+
+        lock.unlock();
+
+        // Re-dissections are only queued once a reload has bumped the
+        // generation and been loaded, so a batch taken before the
+        // generation is checked again cannot hold any for a newer script.
+        std::vector<std::unique_ptr<Packet>> batch = take();
+        lock.lock();
+        const bool stale = generation != ctx.generation;
         lock.unlock();
+        if (stale) {
+          requeue(std::move(batch));
+          continue;
+        }
 
-        v8::Local<v8::Object> packetObj =
-            v8pp::class_<Packet>::reference_external(isolate, pkt.get());
+        for (auto &item : batch) {
+          v8::HandleScope handle_scope(isolate);
+          std::shared_ptr<Packet> pkt = std::move(item);
 
-        std::unordered_map<std::string, std::shared_ptr<Layer>> layers =
-            pkt->layers();
+          // Only wrapped once a script needs it.
+          v8::Local<v8::Object> packetObj;
 
-        std::unordered_set<std::string> usedNs;
-        std::vector<std::unique_ptr<StreamChunk>> streams;
+          std::unordered_map<std::string, std::shared_ptr<Layer>> layers =
+              pkt->layers();
 
-        while (!layers.empty()) {
-          std::unordered_map<std::string, std::shared_ptr<Layer>> nextLayers;
+          std::unordered_set<std::string> usedNs;
+          std::vector<std::unique_ptr<StreamChunk>> streams;
 
-          for (const auto &pair : layers) {
-            usedNs.insert(pair.first);
-            pair.second->setPacket(pkt);
+          // A partial clone only re-runs dissectors below its pending layers.
+          const std::vector<std::shared_ptr<Layer>> &pending =
+              pkt->takePendingLayers();
+          const bool partial = !pending.empty();
+          if (partial) {
+            attachLayers(pkt->layers(), pkt, &usedNs);
+            layers.clear();
+            for (const auto &layer : pending) {
+              layers[layer->ns()] = layer;
+            }
+          }
 
-            for (const DissectorFunc *diss :
-                 findDessector(pair.first, dissectors, &nsMap)) {
-              v8::Local<v8::Function> func =
-                  v8::Local<v8::Function>::New(isolate, diss->func);
-              v8::Local<v8::Object> obj = func->NewInstance();
-              if (obj.IsEmpty()) {
-                if (ctx.logCb) {
-                  ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
-                                                    "dissector"));
+          while (!layers.empty()) {
+            std::unordered_map<std::string, std::shared_ptr<Layer>> nextLayers;
+
+            for (const auto &pair : layers) {
+              usedNs.insert(pair.first);
+              pair.second->setPacket(pkt);
+
+              for (uint32_t index : table->find(pair.first)) {
+                const DissectorFunc *diss = funcs[index];
+                if (!diss || diss->health->disabled)
+                  continue;
+                if (diss->native) {
+                  analyzeNative(*diss, pkt, pair.second, &nextLayers,
+                                &streams);
+                  continue;
+                }
+                if (packetObj.IsEmpty()) {
+                  packetObj = v8pp::class_<Packet>::reference_external(
+                      isolate, pkt.get());
+                }
+                const auto start = std::chrono::steady_clock::now();
+                const size_t streamCount = streams.size();
+                size_t layerCount = 0;
+                bool failed = false;
+
+                v8::Local<v8::Function> func =
+                    v8::Local<v8::Function>::New(isolate, diss->func);
+                const bool stateless = !diss->analyze.IsEmpty();
+                slot->arm();
+                v8::Local<v8::Object> obj =
+                    stateless ? v8::Local<v8::Object>(func)
+                              : func->NewInstance();
+                v8::Local<v8::Value> result;
+                if (obj.IsEmpty()) {
+                  failed = true;
+                  scriptError(*diss, try_catch, *pkt, pair.second.get());
+                } else {
+                  v8::Local<v8::Value> analyze;
+                  if (stateless) {
+                    analyze =
+                        v8::Local<v8::Function>::New(isolate, diss->analyze);
+                  } else {
+                    analyze = obj->Get(v8pp::to_v8(isolate, "analyze"));
+                  }
+                  if (!analyze.IsEmpty() && analyze->IsFunction()) {
+                    v8::Local<v8::Function> analyzeFunc =
+                        analyze.As<v8::Function>();
+                    v8::Local<v8::Object> layerObj =
+                        v8pp::class_<Layer>::reference_external(
+                            isolate, pair.second.get());
+                    v8::Handle<v8::Value> args[2] = {packetObj, layerObj};
+                    result = analyzeFunc->Call(obj, 2, args);
+
+                    v8pp::class_<Layer>::unreference_external(
+                        isolate, pair.second.get());
+
+                    if (result.IsEmpty()) {
+                      failed = true;
+                      scriptError(*diss, try_catch, *pkt, pair.second.get());
+                    }
+                  }
                 }
-              } else {
-                v8::Local<v8::Value> analyze =
-                    obj->Get(v8pp::to_v8(isolate, "analyze"));
-                if (!analyze.IsEmpty() && analyze->IsFunction()) {
-                  v8::Local<v8::Function> analyzeFunc =
-                      analyze.As<v8::Function>();
-                  v8::Local<v8::Object> layerObj =
-                      v8pp::class_<Layer>::reference_external(
-                          isolate, pair.second.get());
-                  v8::Handle<v8::Value> args[2] = {packetObj, layerObj};
-                  v8::Local<v8::Value> result = analyzeFunc->Call(
-                      isolate->GetCurrentContext()->Global(), 2, args);
-
-                  v8pp::class_<Layer>::unreference_external(isolate,
-                                                            pair.second.get());
 
+                // Whatever a terminated call returned is dropped, and the
+                // result is only read once the isolate can run again.
+                if (slot->disarm()) {
+                  failed = true;
+                  timedOut(*diss, *pkt, pair.second.get());
+                } else if (!result.IsEmpty()) {
                   std::vector<std::shared_ptr<Layer>> childLayers;
-
-                  if (result.IsEmpty()) {
-                    if (ctx.logCb) {
-                      ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
-                                                        "dissector"));
-                    }
-                  } else if (result->IsArray()) {
+                  if (result->IsArray()) {
+                    // Copies of a Layer or StreamChunk share its data, so
+                    // adopting the script's objects copies no items.
                     v8::Local<v8::Array> array = result.As<v8::Array>();
-                    for (uint32_t i = 0; i < array->Length(); ++i) {
+                    const uint32_t length = array->Length();
+                    for (uint32_t i = 0; i < length; ++i) {
+                      v8::Local<v8::Value> value = array->Get(i);
+                      if (value.IsEmpty())
+                        break;
                       if (Layer *layer = v8pp::class_<Layer>::unwrap_object(
-                              isolate, array->Get(i))) {
+                              isolate, value)) {
                         childLayers.push_back(std::make_shared<Layer>(*layer));
                       } else if (StreamChunk *stream =
                                      v8pp::class_<StreamChunk>::unwrap_object(
-                                         isolate, array->Get(i))) {
+                                         isolate, value)) {
                         auto chunk = std::unique_ptr<StreamChunk>(
                             new StreamChunk(*stream));
                         if (!chunk->layer()) {
@@ -221,31 +313,35 @@ DissectorThread::Private::Private(
                     nextLayers[child->ns()] = child;
                     pair.second->layers()[child->ns()] = child;
                   }
+                  layerCount = childLayers.size();
                 }
+                diss->counters->record(nsecSince(start), failed, layerCount,
+                                       streams.size() - streamCount);
               }
             }
-          }
 
-          for (const std::string &ns : usedNs) {
-            nextLayers.erase(ns);
+            for (const std::string &ns : usedNs) {
+              nextLayers.erase(ns);
+            }
+            nextLayers.swap(layers);
           }
-          nextLayers.swap(layers);
-        }
-
-        v8pp::class_<Packet>::unreference_external(isolate, pkt.get());
 
-        uint32_t seq = pkt->seq();
+          if (!packetObj.IsEmpty())
+            v8pp::class_<Packet>::unreference_external(isolate, pkt.get());
+          pkt->buildLayerIndex();
 
-        if (ctx.packetCb)
-          ctx.packetCb(pkt);
+          uint32_t seq = pkt->seq();
 
-        if (ctx.streamsCb)
-          ctx.streamsCb(seq, std::move(streams));
+          if (ctx.packetCb)
+            ctx.packetCb(pkt);
 
-        lock.lock();
+          if (ctx.streamsCb && !partial)
+            ctx.streamsCb(seq, std::move(streams));
+        }
       }
     }
 
+    slot.reset();
     isolate->Dispose();
   });
 }
@@ -260,42 +356,325 @@ DissectorThread::Private::~Private() {
     thread.join();
 }
 
-const std::vector<const DissectorFunc *> &
-DissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
-    std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-        *nsMap) {
-  static const std::vector<DissectorFunc *> null;
-
-  auto it = nsMap->find(ns);
-  if (it != nsMap->end())
-    return it->second;
-
-  std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
+// Compiles the scripts that changed since the last call and drops the ones
+// that were removed.
+void DissectorThread::Private::load(
+    v8::Isolate *isolate, const v8::TryCatch &try_catch,
+    const std::vector<Dissector> &scripts,
+    std::unordered_map<std::string, DissectorFunc> *dissectors) {
+  v8::HandleScope handle_scope(isolate);
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  std::unordered_set<std::string> names;
+  for (const Dissector &diss : scripts) {
+    names.insert(diss.resourceName);
+    const auto it = dissectors->find(diss.resourceName);
+    if (it != dissectors->end() && it->second.script == diss.script &&
+        it->second.nativeName == diss.native)
+      continue;
+    dissectors->erase(diss.resourceName);
+
+    if (!diss.native.empty() || WasmDissector::isModule(diss.script)) {
+      std::unique_ptr<NativeDissector> native;
+      std::string error = "Unknown native dissector: " + diss.native;
+      // Instantiating a WebAssembly module runs its start function.
+      slot->arm();
+      try {
+        if (diss.native.empty()) {
+          native.reset(new WasmDissector(isolate, diss.script));
+        } else {
+          native = NativeDissector::create(diss.native, diss.script);
+        }
+      } catch (const std::exception &e) {
+        error = e.what();
       }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
+      if (slot->disarm()) {
+        native.reset();
+        error = loadTimeoutMessage();
+      }
+      if (!native) {
+        if (ctx->logCb) {
+          LogMessage msg;
+          msg.level = LogMessage::LEVEL_ERROR;
+          msg.message = error;
+          msg.domain = "dissector";
+          msg.resourceName = diss.resourceName;
+          ctx->logCb(msg);
         }
+        continue;
+      }
+      DissectorFunc &func = (*dissectors)[diss.resourceName];
+      func.script = diss.script;
+      func.nativeName = diss.native;
+      func.resourceName = diss.resourceName;
+      func.namespaces = native->namespaces();
+      func.native = std::move(native);
+      func.counters = counters(diss.resourceName);
+      func.health = health(diss);
+      continue;
+    }
+
+    v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
+    context->Global()->Set(v8::String::NewFromUtf8(isolate, "module"),
+                           moduleObj);
+
+    // Module code and the getters read below run under the watchdog like
+    // analyze() does.
+    v8::Local<v8::Function> func;
+    DissectorNamespaces namespaces;
+    v8::Local<v8::Function> analyze;
+    slot->arm();
+    Nan::MaybeLocal<Nan::BoundScript> script =
+        CodeCache::compile(isolate, "(function(){" + diss.script + "})()",
+                           diss.resourceName);
+    if (!script.IsEmpty()) {
+      Nan::RunScript(script.ToLocalChecked());
+      v8::Local<v8::Value> result =
+          moduleObj->Get(v8::String::NewFromUtf8(isolate, "exports"));
+
+      if (!result.IsEmpty() && result->IsFunction()) {
+        func = result.As<v8::Function>();
       }
     }
+    if (!func.IsEmpty()) {
+      namespaces = DissectorNamespaces(func);
+
+      // A static analyze needs no instance, so it is called directly on the
+      // class instead of constructing one per layer.
+      v8::Local<v8::Value> value = func->Get(v8pp::to_v8(isolate, "analyze"));
+      if (!value.IsEmpty() && value->IsFunction()) {
+        analyze = value.As<v8::Function>();
+      }
+    }
+    if (slot->disarm()) {
+      if (ctx->logCb) {
+        LogMessage msg;
+        msg.level = LogMessage::LEVEL_ERROR;
+        msg.message = loadTimeoutMessage();
+        msg.domain = "dissector";
+        msg.resourceName = diss.resourceName;
+        ctx->logCb(msg);
+      }
+      continue;
+    }
+    if (func.IsEmpty()) {
+      if (ctx->logCb) {
+        ctx->logCb(LogMessage::fromMessage(try_catch.Message(), "dissector"));
+      }
+      continue;
+    }
+
+    DissectorFunc &entry = (*dissectors)[diss.resourceName];
+    entry.script = diss.script;
+    entry.namespaces = namespaces;
+    entry.func.Reset(isolate, func);
+    entry.analyze.Reset(isolate, analyze);
+    entry.counters = counters(diss.resourceName);
+    entry.health = health(diss);
+  }
+
+  for (auto it = dissectors->begin(); it != dissectors->end();) {
+    if (names.count(it->first)) {
+      ++it;
+    } else {
+      it = dissectors->erase(it);
+    }
+  }
+}
+
+std::shared_ptr<DissectorCounters>
+DissectorThread::Private::counters(const std::string &name) {
+  std::lock_guard<std::mutex> lock(ctx->statsMutex);
+  std::shared_ptr<DissectorCounters> &counters = ctx->counters[index][name];
+  if (!counters) {
+    counters = std::make_shared<DissectorCounters>();
+  }
+  return counters;
+}
+
+// Shared by every thread that loaded the same script.
+std::shared_ptr<DissectorHealth>
+DissectorThread::Private::health(const Dissector &diss) {
+  std::lock_guard<std::mutex> lock(ctx->statsMutex);
+  std::shared_ptr<DissectorHealth> &health = ctx->health[diss.resourceName];
+  if (!health || health->script != diss.script ||
+      health->native != diss.native) {
+    health = std::make_shared<DissectorHealth>();
+    health->script = diss.script;
+    health->native = diss.native;
+  }
+  return health;
+}
+
+// A terminated call leaves no message behind, so it must be disarmed before
+// the exception is logged.
+void DissectorThread::Private::scriptError(const DissectorFunc &diss,
+                                           const v8::TryCatch &try_catch,
+                                           const Packet &pkt, Layer *layer) {
+  if (slot->disarm()) {
+    timedOut(diss, pkt, layer);
+  } else if (ctx->logCb) {
+    ctx->logCb(LogMessage::fromMessage(try_catch.Message(), "dissector"));
+  }
+}
+
+// Marks the packet so that it can be filtered, and disables the dissector
+// once it has timed out too often.
+void DissectorThread::Private::timedOut(const DissectorFunc &diss,
+                                        const Packet &pkt, Layer *layer) {
+  layer->setAttr("dissectorTimeout", ItemValue(ItemValue::STRING,
+                                               diss.resourceName));
+  const int timeouts = ++diss.health->timeouts;
+  const bool disable = ctx->maxTimeouts > 0 &&
+                       timeouts >= ctx->maxTimeouts &&
+                       !diss.health->disabled.exchange(true);
+  if (!ctx->logCb)
+    return;
+
+  LogMessage msg;
+  msg.level = LogMessage::LEVEL_ERROR;
+  msg.message = "Timed out after " +
+                std::to_string(ctx->watchdog->timeout()) + " ms on packet #" +
+                std::to_string(pkt.seq());
+  msg.domain = "dissector";
+  msg.resourceName = diss.resourceName;
+  ctx->logCb(msg);
+  if (disable) {
+    msg.level = LogMessage::LEVEL_WARN;
+    msg.message = "Disabled after " + std::to_string(timeouts) + " timeouts";
+    ctx->logCb(msg);
+  }
+}
+
+std::string DissectorThread::Private::loadTimeoutMessage() const {
+  return "Timed out after " + std::to_string(ctx->watchdog->timeout()) +
+         " ms while loading";
+}
+
+// Runs a native dissector and links its layers like a script's result.
+void DissectorThread::Private::analyzeNative(
+    const DissectorFunc &diss, const std::shared_ptr<Packet> &pkt,
+    const std::shared_ptr<Layer> &parentLayer,
+    std::unordered_map<std::string, std::shared_ptr<Layer>> *nextLayers,
+    std::vector<std::unique_ptr<StreamChunk>> *streams) {
+  std::vector<std::shared_ptr<Layer>> childLayers;
+  std::vector<std::unique_ptr<StreamChunk>> chunks;
+  const auto start = std::chrono::steady_clock::now();
+  // Only WebAssembly modules run in the isolate, but arming is cheap.
+  slot->arm();
+  std::string error;
+  bool failed = false;
+  try {
+    diss.native->analyze(*pkt, *parentLayer, &childLayers, &chunks);
+  } catch (const std::exception &e) {
+    error = e.what();
+    failed = true;
   }
+  if (slot->disarm()) {
+    diss.counters->record(nsecSince(start), true, 0, 0);
+    timedOut(diss, *pkt, parentLayer.get());
+    return;
+  }
+  if (failed) {
+    diss.counters->record(nsecSince(start), true, 0, 0);
+    if (ctx->logCb) {
+      LogMessage msg;
+      msg.level = LogMessage::LEVEL_ERROR;
+      msg.message = error;
+      msg.domain = "dissector";
+      msg.resourceName = diss.resourceName;
+      ctx->logCb(msg);
+    }
+    return;
+  }
+  diss.counters->record(nsecSince(start), false, childLayers.size(),
+                        chunks.size());
 
-  return funcs;
+  for (auto &chunk : chunks) {
+    if (!chunk->layer()) {
+      chunk->setLayer(parentLayer);
+    }
+    streams->push_back(std::move(chunk));
+  }
+  for (const auto &child : childLayers) {
+    (*nextLayers)[child->ns()] = child;
+    parentLayer->layers()[child->ns()] = child;
+  }
+}
+
+// Takes a batch from this thread's queue, or steals half of another
+// thread's queue when it is empty.
+std::vector<std::unique_ptr<Packet>> DissectorThread::Private::take() {
+  std::vector<std::unique_ptr<Packet>> batch;
+  const size_t size = ctx->queues.size();
+  for (size_t i = 0; i < size && batch.empty(); ++i) {
+    PacketQueue &queue = *ctx->queues[(index + i) % size];
+    std::unique_lock<std::mutex> lock(queue.mutex, std::defer_lock);
+    if (i == 0) {
+      lock.lock();
+    } else if (!lock.try_lock()) {
+      continue;
+    }
+    size_t count = std::min(queue.packets.size(), maxBatchSize);
+    if (i > 0)
+      count = std::min(count, (queue.packets.size() + 1) / 2);
+    for (size_t j = 0; j < count; ++j) {
+      batch.push_back(std::move(queue.packets.front()));
+      queue.packets.pop_front();
+    }
+  }
+  size_t bytes = 0;
+  for (const auto &pkt : batch) {
+    bytes += pkt->length();
+  }
+  ctx->queuedBytes -= bytes;
+  ctx->pending -= batch.size();
+  if (!batch.empty() && ctx->blocked > 0) {
+    { std::lock_guard<std::mutex> lock(ctx->mutex); }
+    ctx->spaceCond.notify_all();
+  }
+  return batch;
+}
+
+// Puts a batch back in front of this thread's queue in its original order.
+void DissectorThread::Private::requeue(
+    std::vector<std::unique_ptr<Packet>> batch) {
+  size_t bytes = 0;
+  for (const auto &pkt : batch) {
+    bytes += pkt->length();
+  }
+  {
+    PacketQueue &queue = *ctx->queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
+      queue.packets.push_front(std::move(*it));
+    }
+  }
+  ctx->queuedBytes += bytes;
+  ctx->pending += batch.size();
+}
+
+// Threads that loaded the same generation share one table. Called with
+// the context mutex held.
+std::shared_ptr<const NamespaceTable> DissectorThread::Private::namespaceTable(
+    uint32_t generation,
+    const std::unordered_map<std::string, DissectorFunc> &funcs) {
+  if (ctx->tableGeneration == generation)
+    return ctx->table;
+
+  std::vector<std::pair<std::string, DissectorNamespaces>> dissectors;
+  for (const auto &pair : funcs) {
+    dissectors.emplace_back(pair.first, pair.second.namespaces);
+  }
+  auto table = std::make_shared<const NamespaceTable>(dissectors);
+  if (ctx->tableGeneration < generation) {
+    ctx->table = table;
+    ctx->tableGeneration = generation;
+  }
+  return table;
 }
 
 DissectorThread::DissectorThread(
-    const std::shared_ptr<DissectorSharedContext> &ctx)
-    : d(new Private(ctx)) {}
+    const std::shared_ptr<DissectorSharedContext> &ctx, size_t index)
+    : d(new Private(ctx, index)) {}
 
 DissectorThread::~DissectorThread() {}
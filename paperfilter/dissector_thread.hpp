@@ -7,14 +7,14 @@
 #include <vector>
 
 class Packet;
-class PacketQueue;
 class StreamChunk;
 struct LogMessage;
 struct DissectorSharedContext;
 
 class DissectorThread {
 public:
-  DissectorThread(const std::shared_ptr<DissectorSharedContext> &ctx);
+  DissectorThread(const std::shared_ptr<DissectorSharedContext> &ctx,
+                  size_t index);
   ~DissectorThread();
   DissectorThread(const DissectorThread &) = delete;
   DissectorThread &operator=(const DissectorThread &) = delete;
@@ -1,292 +1,1499 @@
 #include "filter.hpp"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "code_cache.hpp"
+#include "item_value.hpp"
 #include "layer.hpp"
+#include "layer_id.hpp"
 #include "packet.hpp"
-#include "item_value.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
 #include <json11.hpp>
 #include <nan.h>
+#include <set>
+#include <unordered_set>
 #include <v8pp/class.hpp>
 #include <v8pp/json.hpp>
 #include <v8pp/object.hpp>
 
-FilterFunc makeFilter(const json11::Json &json) {
-  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+namespace {
 
-  const std::string &type = json["type"].string_value();
+// Intermediate values are kept native while a filter is evaluated. Strings,
+// buffers and JSON attrs are views into the packet (or into |keep|), and V8
+// values are only created for objects that have no native counterpart.
+struct FilterValue {
+  enum Type {
+    NUL,
+    NUMBER,
+    BOOLEAN,
+    STRING,
+    BUFFER,
+    JSON,
+    LAYER,
+    PACKET,
+    JS,
+    ADDRESS
+  };
 
-  if (type == "MemberExpression") {
-    const json11::Json &property = json["property"];
-    const std::string &propertyType = property["type"].string_value();
-    FilterFunc propertyFunc;
+  Type type = NUL;
+  double num = 0;
+  const char *data = nullptr;
+  size_t size = 0;
+  const json11::Json *json = nullptr;
+  const Layer *layer = nullptr;
+  Packet *pkt = nullptr;
+  std::shared_ptr<const void> keep;
+  v8::Local<v8::Value> js;
+};
 
-    if (propertyType == "Identifier") {
-      const std::string &name = property["name"].string_value();
-      propertyFunc = [isolate, name](Packet *) {
-        return v8pp::to_v8(isolate, name);
-      };
-    } else {
-      propertyFunc = makeFilter(property);
+typedef std::function<FilterValue(Packet *)> ValueFunc;
+
+struct Expr {
+  ValueFunc func;
+  bool constant = false;
+};
+
+bool isPrimitive(const FilterValue &value) {
+  return value.type <= FilterValue::STRING;
+}
+
+FilterValue numberValue(double num) {
+  FilterValue value;
+  value.type = FilterValue::NUMBER;
+  value.num = num;
+  return value;
+}
+
+FilterValue booleanValue(bool b) {
+  FilterValue value;
+  value.type = FilterValue::BOOLEAN;
+  value.num = b;
+  return value;
+}
+
+FilterValue stringValue(const char *data, size_t size) {
+  FilterValue value;
+  value.type = FilterValue::STRING;
+  value.data = data;
+  value.size = size;
+  return value;
+}
+
+FilterValue stringValue(std::string str) {
+  const auto &owned = std::make_shared<std::string>(std::move(str));
+  FilterValue value = stringValue(owned->data(), owned->size());
+  value.keep = owned;
+  return value;
+}
+
+FilterValue bufferValue(std::unique_ptr<Buffer> buffer) {
+  std::shared_ptr<const Buffer> buf(std::move(buffer));
+  FilterValue value;
+  value.type = FilterValue::BUFFER;
+  value.data = buf->data();
+  value.size = buf->length();
+  value.keep = buf;
+  return value;
+}
+
+FilterValue jsonValue(const json11::Json &json,
+                      const std::shared_ptr<const void> &keep) {
+  switch (json.type()) {
+  case json11::Json::NUMBER:
+    return numberValue(json.number_value());
+  case json11::Json::BOOL:
+    return booleanValue(json.bool_value());
+  case json11::Json::STRING: {
+    const std::string &str = json.string_value();
+    FilterValue value = stringValue(str.data(), str.size());
+    value.keep = keep;
+    return value;
+  }
+  case json11::Json::ARRAY:
+  case json11::Json::OBJECT: {
+    FilterValue value;
+    value.type = FilterValue::JSON;
+    value.json = &json;
+    value.keep = keep;
+    return value;
+  }
+  default:
+    return FilterValue();
+  }
+}
+
+FilterValue itemValue(const ItemValue &item) {
+  switch (item.base()) {
+  case ItemValue::NUMBER:
+    return numberValue(item.number());
+  case ItemValue::BOOLEAN:
+    return booleanValue(item.number());
+  case ItemValue::STRING:
+    return stringValue(item.string().data(), item.string().size());
+  case ItemValue::BUFFER:
+    if (const Buffer *buf = item.buffer()) {
+      FilterValue value;
+      value.type = FilterValue::BUFFER;
+      value.data = buf->data();
+      value.size = buf->length();
+      return value;
+    }
+    break;
+  case ItemValue::JSON: {
+    const std::shared_ptr<const json11::Json> &json = item.json();
+    return jsonValue(*json, json);
+  }
+  case ItemValue::LARGE_BUFFER: {
+    FilterValue value;
+    value.type = FilterValue::JS;
+    value.js = item.data();
+    return value;
+  }
+  case ItemValue::ADDRESS: {
+    FilterValue value;
+    value.type = FilterValue::ADDRESS;
+    value.data = item.address().data();
+    value.size = item.address().size();
+    return value;
+  }
+  default:;
+  }
+  return FilterValue();
+}
+
+v8::Local<v8::Object> packetObject(v8::Isolate *isolate, Packet *pkt) {
+  v8::Local<v8::Object> pktObject =
+      v8pp::class_<Packet>::find_object(isolate, pkt);
+  if (pktObject.IsEmpty()) {
+    pktObject = v8pp::class_<Packet>::reference_external(isolate, pkt);
+  }
+  return pktObject;
+}
+
+v8::Local<v8::Value> toJS(v8::Isolate *isolate, const FilterValue &value) {
+  switch (value.type) {
+  case FilterValue::NUMBER:
+    return v8::Number::New(isolate, value.num);
+  case FilterValue::BOOLEAN:
+    return v8::Boolean::New(isolate, value.num != 0);
+  case FilterValue::STRING:
+    return v8pp::to_v8(isolate, value.data, value.size);
+  case FilterValue::BUFFER: {
+    std::unique_ptr<Buffer> buffer(
+        new Buffer(std::make_shared<std::vector<char>>(
+            value.data, value.data + value.size)));
+    buffer->freeze();
+    return v8pp::class_<Buffer>::import_external(isolate, buffer.release());
+  }
+  case FilterValue::JSON:
+    return v8pp::json_parse(isolate, value.json->dump());
+  case FilterValue::LAYER:
+    return v8pp::class_<Layer>::reference_external(
+        isolate, const_cast<Layer *>(value.layer));
+  case FilterValue::PACKET:
+    return packetObject(isolate, value.pkt);
+  case FilterValue::JS:
+    return value.js;
+  case FilterValue::ADDRESS:
+    return v8pp::to_v8(isolate, Address::format(value.data, value.size));
+  default:
+    return v8::Null(isolate);
+  }
+}
+
+FilterValue fromJS(v8::Isolate *isolate, v8::Local<v8::Value> val) {
+  if (val.IsEmpty() || val->IsNull() || val->IsUndefined()) {
+    return FilterValue();
+  } else if (val->IsNumber()) {
+    return numberValue(val->NumberValue());
+  } else if (val->IsBoolean()) {
+    return booleanValue(val->BooleanValue());
+  } else if (val->IsString()) {
+    return stringValue(v8pp::from_v8<std::string>(isolate, val, ""));
+  }
+  FilterValue value;
+  value.type = FilterValue::JS;
+  value.js = val;
+  return value;
+}
+
+bool toBoolean(const FilterValue &value) {
+  switch (value.type) {
+  case FilterValue::NUL:
+    return false;
+  case FilterValue::NUMBER:
+  case FilterValue::BOOLEAN:
+    return value.num != 0 && !std::isnan(value.num);
+  case FilterValue::STRING:
+    return value.size > 0;
+  case FilterValue::JS:
+    return value.js->BooleanValue();
+  default:
+    return true;
+  }
+}
+
+double stringToNumber(const char *data, size_t size) {
+  const char *begin = data;
+  const char *end = data + size;
+  while (begin < end && std::isspace(static_cast<unsigned char>(*begin)))
+    ++begin;
+  while (end > begin && std::isspace(static_cast<unsigned char>(end[-1])))
+    --end;
+  if (begin == end)
+    return 0;
+  const std::string str(begin, end);
+  char *last = nullptr;
+  double num = std::strtod(str.c_str(), &last);
+  if (last != str.c_str() + str.size())
+    return NAN;
+  return num;
+}
+
+double toNumber(v8::Isolate *isolate, const FilterValue &value) {
+  switch (value.type) {
+  case FilterValue::NUL:
+    return 0;
+  case FilterValue::NUMBER:
+  case FilterValue::BOOLEAN:
+    return value.num;
+  case FilterValue::STRING:
+    return stringToNumber(value.data, value.size);
+  default:
+    return toJS(isolate, value)->NumberValue();
+  }
+}
+
+uint32_t toUint32(double num) {
+  if (!std::isfinite(num))
+    return 0;
+  double mod = std::fmod(std::trunc(num), 4294967296.0);
+  if (mod < 0)
+    mod += 4294967296.0;
+  return static_cast<uint32_t>(mod);
+}
+
+int32_t toInt32(double num) { return static_cast<int32_t>(toUint32(num)); }
+
+std::string toString(v8::Isolate *isolate, const FilterValue &value) {
+  switch (value.type) {
+  case FilterValue::STRING:
+    return std::string(value.data, value.size);
+  case FilterValue::ADDRESS:
+    return Address::format(value.data, value.size);
+  case FilterValue::BOOLEAN:
+    return value.num ? "true" : "false";
+  case FilterValue::NUL:
+    return "null";
+  case FilterValue::NUMBER:
+    if (value.num == std::trunc(value.num) && std::fabs(value.num) < 1e15) {
+      return std::to_string(static_cast<long long>(value.num));
+    }
+  // fall through
+  default:
+    return v8pp::from_v8<std::string>(isolate,
+                                      toJS(isolate, value)->ToString(), "");
+  }
+}
+
+// Addresses behave like their formatted strings, which is what they were
+// before they got a native representation.
+bool isStringLike(const FilterValue &value) {
+  return value.type == FilterValue::STRING ||
+         value.type == FilterValue::ADDRESS;
+}
+
+bool addressEquals(const FilterValue &lhs, const FilterValue &rhs) {
+  if (lhs.type == FilterValue::ADDRESS && rhs.type == FilterValue::ADDRESS)
+    return lhs.size == rhs.size &&
+           std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+  const FilterValue &addr = lhs.type == FilterValue::ADDRESS ? lhs : rhs;
+  const FilterValue &str = lhs.type == FilterValue::ADDRESS ? rhs : lhs;
+  const std::string &formatted = Address::format(addr.data, addr.size);
+  return formatted.size() == str.size &&
+         std::memcmp(formatted.data(), str.data, str.size) == 0;
+}
+
+bool looseEquals(v8::Isolate *isolate, const FilterValue &lhs,
+                 const FilterValue &rhs) {
+  if ((lhs.type == FilterValue::ADDRESS || rhs.type == FilterValue::ADDRESS) &&
+      isStringLike(lhs) && isStringLike(rhs))
+    return addressEquals(lhs, rhs);
+  if (isPrimitive(lhs) && isPrimitive(rhs)) {
+    if (lhs.type == FilterValue::NUL || rhs.type == FilterValue::NUL)
+      return lhs.type == rhs.type;
+    if (lhs.type == FilterValue::STRING && rhs.type == FilterValue::STRING)
+      return lhs.size == rhs.size &&
+             std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+    return toNumber(isolate, lhs) == toNumber(isolate, rhs);
+  }
+  return toJS(isolate, lhs)->Equals(toJS(isolate, rhs));
+}
+
+bool strictEquals(v8::Isolate *isolate, const FilterValue &lhs,
+                  const FilterValue &rhs) {
+  if (lhs.type == FilterValue::ADDRESS || rhs.type == FilterValue::ADDRESS)
+    return isStringLike(lhs) && isStringLike(rhs) && addressEquals(lhs, rhs);
+  if (isPrimitive(lhs) && isPrimitive(rhs)) {
+    if (lhs.type != rhs.type)
+      return false;
+    if (lhs.type == FilterValue::STRING)
+      return lhs.size == rhs.size &&
+             std::memcmp(lhs.data, rhs.data, lhs.size) == 0;
+    return lhs.type == FilterValue::NUL || lhs.num == rhs.num;
+  }
+  return toJS(isolate, lhs)->StrictEquals(toJS(isolate, rhs));
+}
+
+int compare(v8::Isolate *isolate, const FilterValue &lhs,
+            const FilterValue &rhs, bool *unordered) {
+  *unordered = false;
+  if ((lhs.type == FilterValue::ADDRESS || rhs.type == FilterValue::ADDRESS) &&
+      isStringLike(lhs) && isStringLike(rhs)) {
+    int result = toString(isolate, lhs).compare(toString(isolate, rhs));
+    return result < 0 ? -1 : (result > 0 ? 1 : 0);
+  }
+  if (lhs.type == FilterValue::STRING && rhs.type == FilterValue::STRING) {
+    int result =
+        std::memcmp(lhs.data, rhs.data, std::min(lhs.size, rhs.size));
+    if (result == 0)
+      return lhs.size < rhs.size ? -1 : (lhs.size > rhs.size ? 1 : 0);
+    return result;
+  }
+  double l = toNumber(isolate, lhs);
+  double r = toNumber(isolate, rhs);
+  if (std::isnan(l) || std::isnan(r)) {
+    *unordered = true;
+    return 0;
+  }
+  return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+size_t utf16Length(const char *data, size_t size) {
+  size_t length = 0;
+  for (size_t i = 0; i < size; ++i) {
+    uint8_t c = data[i];
+    if ((c & 0xc0) != 0x80)
+      length++;
+    if (c >= 0xf0)
+      length++;
+  }
+  return length;
+}
+
+bool parseIndex(const std::string &name, size_t *index) {
+  if (name.empty() || name.size() > 9)
+    return false;
+  size_t num = 0;
+  for (char c : name) {
+    if (c < '0' || c > '9')
+      return false;
+    num = num * 10 + (c - '0');
+  }
+  *index = num;
+  return true;
+}
+
+bool packetProperty(Packet *pkt, const std::string &name, FilterValue *value) {
+  if (name == "seq") {
+    *value = numberValue(pkt->seq());
+  } else if (name == "ts_sec") {
+    *value = numberValue(pkt->ts_sec());
+  } else if (name == "ts_nsec") {
+    *value = numberValue(pkt->ts_nsec());
+  } else if (name == "length") {
+    *value = numberValue(pkt->length());
+  } else if (name == "payload") {
+    std::unique_ptr<Buffer> payload = pkt->payload();
+    if (!payload)
+      return false;
+    *value = bufferValue(std::move(payload));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool layerProperty(const Layer *layer, const std::string &name,
+                   FilterValue *value) {
+  if (name == "namespace") {
+    *value = stringValue(layer->ns());
+  } else if (name == "name") {
+    *value = stringValue(layer->name());
+  } else if (name == "id") {
+    *value = stringValue(layer->id());
+  } else if (name == "summary") {
+    *value = stringValue(layer->summary());
+  } else if (name == "range") {
+    *value = stringValue(layer->range());
+  } else if (name == "payload") {
+    std::unique_ptr<Buffer> payload = layer->payload();
+    if (!payload)
+      return false;
+    *value = bufferValue(std::move(payload));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+FilterValue jsMember(v8::Isolate *isolate, v8::Local<v8::Value> object,
+                     const std::string &name) {
+  if (object->IsString()) {
+    object = v8::StringObject::New(object.As<v8::String>());
+  }
+  if (object->IsObject()) {
+    v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
+    if (object.As<v8::Object>()->Has(key)) {
+      return fromJS(isolate, object.As<v8::Object>()->Get(key));
     }
+  }
+  return FilterValue();
+}
 
-    const FilterFunc &objectFunc = makeFilter(json["object"]);
-
-    return FilterFunc([isolate, objectFunc,
-                       propertyFunc](Packet *pkt) -> v8::Local<v8::Value> {
-      v8::Local<v8::Value> object = objectFunc(pkt);
-      v8::Local<v8::Value> property = propertyFunc(pkt);
-
-      const std::string &name =
-          v8pp::from_v8<std::string>(isolate, property, "");
-      if (name.empty())
-        return v8::Null(isolate);
-
-      if (const Layer *layer =
-              v8pp::class_<Layer>::unwrap_object(isolate, object)) {
-        const std::unordered_map<std::string, ItemValue> &attrs =
-            layer->attrs();
-        const auto it = attrs.find(name);
-        if (it != attrs.end()) {
-          return it->second.data();
+FilterValue member(v8::Isolate *isolate, const FilterValue &object,
+                   const std::string &name) {
+  switch (object.type) {
+  case FilterValue::NUL:
+  case FilterValue::NUMBER:
+  case FilterValue::BOOLEAN:
+    return FilterValue();
+  case FilterValue::STRING:
+    if (name == "length")
+      return numberValue(utf16Length(object.data, object.size));
+    break;
+  case FilterValue::ADDRESS:
+    if (name == "length")
+      return numberValue(Address::format(object.data, object.size).size());
+    break;
+  case FilterValue::BUFFER: {
+    size_t index;
+    if (name == "length") {
+      return numberValue(object.size);
+    } else if (parseIndex(name, &index)) {
+      if (index < object.size)
+        return numberValue(static_cast<uint8_t>(object.data[index]));
+      return FilterValue();
+    }
+    break;
+  }
+  case FilterValue::JSON: {
+    const json11::Json &json = *object.json;
+    size_t index;
+    if (json.is_object()) {
+      const auto &items = json.object_items();
+      const auto it = items.find(name);
+      if (it != items.end())
+        return jsonValue(it->second, object.keep);
+      return FilterValue();
+    } else if (name == "length") {
+      return numberValue(json.array_items().size());
+    } else if (parseIndex(name, &index)) {
+      if (index < json.array_items().size())
+        return jsonValue(json.array_items()[index], object.keep);
+      return FilterValue();
+    }
+    break;
+  }
+  case FilterValue::LAYER: {
+    const auto &attrs = object.layer->attrs();
+    const auto it = attrs.find(name);
+    if (it != attrs.end())
+      return itemValue(it->second);
+    FilterValue value;
+    if (layerProperty(object.layer, name, &value))
+      return value;
+    break;
+  }
+  case FilterValue::PACKET: {
+    FilterValue value;
+    if (packetProperty(object.pkt, name, &value))
+      return value;
+    break;
+  }
+  default:;
+  }
+  return jsMember(isolate, toJS(isolate, object), name);
+}
+
+bool isPacketProperty(const std::string &name) {
+  return name == "seq" || name == "ts_sec" || name == "ts_nsec" ||
+         name == "length" || name == "payload" || name == "layers";
+}
+
+Expr constant(const FilterValue &value) {
+  Expr expr;
+  expr.constant = true;
+  const std::shared_ptr<const void> keep = value.keep;
+  FilterValue view = value;
+  view.keep.reset();
+  expr.func = [view, keep](Packet *) { return view; };
+  return expr;
+}
+
+Expr fold(const ValueFunc &func, std::initializer_list<const Expr *> operands) {
+  Expr expr;
+  expr.func = func;
+  for (const Expr *operand : operands) {
+    if (!operand->constant)
+      return expr;
+  }
+  const FilterValue &value = func(nullptr);
+  if (isPrimitive(value))
+    return constant(value);
+  return expr;
+}
+
+Expr makeExpr(v8::Isolate *isolate, const json11::Json &json);
+
+// Tests |value| against a network; strings are parsed as addresses.
+bool inNetwork(const FilterValue &value, const std::string &network,
+               size_t prefix) {
+  if (value.type == FilterValue::ADDRESS)
+    return Address::inNetwork(value.data, value.size, network, prefix);
+  std::string bytes;
+  return value.type == FilterValue::STRING &&
+         Address::parse(std::string(value.data, value.size), &bytes) &&
+         Address::inNetwork(bytes.data(), bytes.size(), network, prefix);
+}
+
+// `value in 'cidr'` matches addresses against a network; any other right
+// hand side keeps the JS meaning of `in`.
+Expr makeIn(v8::Isolate *isolate, const Expr &lhs, const Expr &rhs) {
+  const ValueFunc lf = lhs.func;
+  const ValueFunc rf = rhs.func;
+  if (rhs.constant) {
+    const FilterValue &net = rf(nullptr);
+    std::string network;
+    size_t prefix;
+    if (net.type == FilterValue::STRING &&
+        Address::parseNetwork(std::string(net.data, net.size), &network,
+                              &prefix)) {
+      return fold(
+          [lf, network, prefix](Packet *pkt) {
+            return booleanValue(inNetwork(lf(pkt), network, prefix));
+          },
+          {&lhs});
+    }
+  }
+  return fold(
+      [isolate, lf, rf](Packet *pkt) {
+        const FilterValue &value = lf(pkt);
+        const FilterValue &object = rf(pkt);
+        std::string network;
+        size_t prefix;
+        if (object.type == FilterValue::STRING) {
+          return booleanValue(
+              Address::parseNetwork(std::string(object.data, object.size),
+                                    &network, &prefix) &&
+              inNetwork(value, network, prefix));
         }
-      }
+        if (isPrimitive(object) || object.type == FilterValue::ADDRESS)
+          return booleanValue(false);
+        return booleanValue(toJS(isolate, object)
+                                .As<v8::Object>()
+                                ->Has(toJS(isolate, value)->ToString()));
+      },
+      {&lhs, &rhs});
+}
+
+// Comparing an address with a constant string only needs a byte compare
+// when the string is the canonical form of an address.
+Expr makeAddressEquals(v8::Isolate *isolate, const std::string &op,
+                       const Expr &addr, const Expr &str, bool *matched) {
+  *matched = false;
+  Expr expr;
+  if (!str.constant || addr.constant)
+    return expr;
+  const FilterValue &literal = str.func(nullptr);
+  if (literal.type != FilterValue::STRING)
+    return expr;
+  const std::string text(literal.data, literal.size);
+  std::string bytes;
+  if (Address::parse(text, &bytes) &&
+      Address::format(bytes.data(), bytes.size()) != text)
+    bytes.clear();
 
-      if (object->IsString()) {
-        object = v8::StringObject::New(object.As<v8::String>());
+  *matched = true;
+  const bool negate = (op == "!=" || op == "!==");
+  const bool strict = (op == "===" || op == "!==");
+  const ValueFunc af = addr.func;
+  const ValueFunc sf = str.func;
+  expr.func = [isolate, af, sf, bytes, negate, strict](Packet *pkt) {
+    const FilterValue &value = af(pkt);
+    bool equals;
+    if (value.type == FilterValue::ADDRESS) {
+      equals = value.size == bytes.size() &&
+               std::memcmp(value.data, bytes.data(), bytes.size()) == 0;
+    } else if (strict) {
+      equals = strictEquals(isolate, value, sf(nullptr));
+    } else {
+      equals = looseEquals(isolate, value, sf(nullptr));
+    }
+    return booleanValue(equals != negate);
+  };
+  return expr;
+}
+
+Expr makeBinary(v8::Isolate *isolate, const std::string &op, const Expr &lhs,
+                const Expr &rhs) {
+  const ValueFunc lf = lhs.func;
+  const ValueFunc rf = rhs.func;
+  ValueFunc func;
+
+  if (op == "==" || op == "!=" || op == "===" || op == "!==") {
+    bool matched;
+    Expr expr = makeAddressEquals(isolate, op, lhs, rhs, &matched);
+    if (!matched && !lhs.constant)
+      expr = makeAddressEquals(isolate, op, rhs, lhs, &matched);
+    if (matched)
+      return expr;
+  }
+
+  if (op == "in") {
+    return makeIn(isolate, lhs, rhs);
+  } else if (op == "==") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return booleanValue(looseEquals(isolate, lf(pkt), rf(pkt)));
+    };
+  } else if (op == "!=") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return booleanValue(!looseEquals(isolate, lf(pkt), rf(pkt)));
+    };
+  } else if (op == "===") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return booleanValue(strictEquals(isolate, lf(pkt), rf(pkt)));
+    };
+  } else if (op == "!==") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return booleanValue(!strictEquals(isolate, lf(pkt), rf(pkt)));
+    };
+  } else if (op == ">") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      bool unordered;
+      int result = compare(isolate, lf(pkt), rf(pkt), &unordered);
+      return booleanValue(!unordered && result > 0);
+    };
+  } else if (op == "<") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      bool unordered;
+      int result = compare(isolate, lf(pkt), rf(pkt), &unordered);
+      return booleanValue(!unordered && result < 0);
+    };
+  } else if (op == ">=") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      bool unordered;
+      int result = compare(isolate, lf(pkt), rf(pkt), &unordered);
+      return booleanValue(!unordered && result >= 0);
+    };
+  } else if (op == "<=") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      bool unordered;
+      int result = compare(isolate, lf(pkt), rf(pkt), &unordered);
+      return booleanValue(!unordered && result <= 0);
+    };
+  } else if (op == "+") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      const FilterValue &l = lf(pkt);
+      const FilterValue &r = rf(pkt);
+      if (isStringLike(l) || isStringLike(r)) {
+        return stringValue(toString(isolate, l) + toString(isolate, r));
       }
+      return numberValue(toNumber(isolate, l) + toNumber(isolate, r));
+    };
+  } else if (op == "-") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toNumber(isolate, lf(pkt)) -
+                         toNumber(isolate, rf(pkt)));
+    };
+  } else if (op == "*") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toNumber(isolate, lf(pkt)) *
+                         toNumber(isolate, rf(pkt)));
+    };
+  } else if (op == "/") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toNumber(isolate, lf(pkt)) /
+                         toNumber(isolate, rf(pkt)));
+    };
+  } else if (op == "%") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(
+          std::fmod(toNumber(isolate, lf(pkt)), toNumber(isolate, rf(pkt))));
+    };
+  } else if (op == "&") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toInt32(toNumber(isolate, lf(pkt))) &
+                         toInt32(toNumber(isolate, rf(pkt))));
+    };
+  } else if (op == "|") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toInt32(toNumber(isolate, lf(pkt))) |
+                         toInt32(toNumber(isolate, rf(pkt))));
+    };
+  } else if (op == "^") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toInt32(toNumber(isolate, lf(pkt))) ^
+                         toInt32(toNumber(isolate, rf(pkt))));
+    };
+  } else if (op == ">>") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toInt32(toNumber(isolate, lf(pkt))) >>
+                         (toUint32(toNumber(isolate, rf(pkt))) & 0x1f));
+    };
+  } else if (op == ">>>") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(toUint32(toNumber(isolate, lf(pkt))) >>
+                         (toUint32(toNumber(isolate, rf(pkt))) & 0x1f));
+    };
+  } else if (op == "<<") {
+    func = [isolate, lf, rf](Packet *pkt) {
+      return numberValue(static_cast<int32_t>(
+          toUint32(toNumber(isolate, lf(pkt)))
+          << (toUint32(toNumber(isolate, rf(pkt))) & 0x1f)));
+    };
+  } else {
+    return constant(FilterValue());
+  }
 
-      if (object->IsObject()) {
-        v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
-        if (object.As<v8::Object>()->Has(key)) {
-          return object.As<v8::Object>()->Get(key);
-        }
+  return fold(func, {&lhs, &rhs});
+}
+
+Expr makeMember(v8::Isolate *isolate, const json11::Json &json) {
+  const json11::Json &property = json["property"];
+  const Expr &object = makeExpr(isolate, json["object"]);
+  const ValueFunc objectFunc = object.func;
+
+  if (!json["computed"].bool_value() &&
+      property["type"].string_value() == "Identifier") {
+    const std::string &name = property["name"].string_value();
+    return fold(
+        [isolate, objectFunc, name](Packet *pkt) {
+          return member(isolate, objectFunc(pkt), name);
+        },
+        {&object});
+  }
+
+  const Expr &prop = makeExpr(isolate, property);
+  const ValueFunc propertyFunc = prop.func;
+  return fold(
+      [isolate, objectFunc, propertyFunc](Packet *pkt) {
+        const FilterValue &object = objectFunc(pkt);
+        const std::string &name = toString(isolate, propertyFunc(pkt));
+        if (name.empty())
+          return FilterValue();
+        return member(isolate, object, name);
+      },
+      {&object, &prop});
+}
+
+Expr makeCall(v8::Isolate *isolate, const json11::Json &json) {
+  std::vector<ValueFunc> argFuncs;
+  for (const json11::Json &item : json["arguments"].array_items()) {
+    argFuncs.push_back(makeExpr(isolate, item).func);
+  }
+
+  const json11::Json &callee = json["callee"];
+  const json11::Json &property = callee["property"];
+  Expr expr;
+
+  if (callee["type"].string_value() == "MemberExpression" &&
+      !callee["computed"].bool_value() &&
+      property["type"].string_value() == "Identifier") {
+    const ValueFunc objectFunc = makeExpr(isolate, callee["object"]).func;
+    const std::string &name = property["name"].string_value();
+    expr.func = [isolate, objectFunc, name, argFuncs](Packet *pkt) {
+      v8::Local<v8::Value> recv = toJS(isolate, objectFunc(pkt));
+      if (recv->IsString()) {
+        recv = v8::StringObject::New(recv.As<v8::String>());
+      }
+      if (!recv->IsObject())
+        return FilterValue();
+      v8::Local<v8::Value> func =
+          recv.As<v8::Object>()->Get(v8pp::to_v8(isolate, name));
+      if (func.IsEmpty() || !func->IsFunction())
+        return FilterValue();
+      std::vector<v8::Local<v8::Value>> args;
+      for (const ValueFunc &arg : argFuncs) {
+        args.push_back(toJS(isolate, arg(pkt)));
+      }
+      return fromJS(isolate, func.As<v8::Object>()->CallAsFunction(
+                                 recv, args.size(), args.data()));
+    };
+  } else {
+    const ValueFunc calleeFunc = makeExpr(isolate, callee).func;
+    expr.func = [isolate, calleeFunc, argFuncs](Packet *pkt) {
+      v8::Local<v8::Value> func = toJS(isolate, calleeFunc(pkt));
+      if (!func->IsFunction())
+        return FilterValue();
+      std::vector<v8::Local<v8::Value>> args;
+      for (const ValueFunc &arg : argFuncs) {
+        args.push_back(toJS(isolate, arg(pkt)));
       }
+      return fromJS(isolate, func.As<v8::Object>()->CallAsFunction(
+                                 isolate->GetCurrentContext()->Global(),
+                                 args.size(), args.data()));
+    };
+  }
+  return expr;
+}
 
-      return v8::Null(isolate);
-    });
-  } else if (type == "BinaryExpression") {
-    const FilterFunc &lf = makeFilter(json["left"]);
-    const FilterFunc &rf = makeFilter(json["right"]);
-    const std::string &op = json["operator"].string_value();
+Expr makeIdentifier(v8::Isolate *isolate, const std::string &name) {
+  Expr expr;
+  if (isPacketProperty(name)) {
+    expr.func = [isolate, name](Packet *pkt) {
+      FilterValue packet;
+      packet.type = FilterValue::PACKET;
+      packet.pkt = pkt;
+      return member(isolate, packet, name);
+    };
+    return expr;
+  }
 
-    if (op == ">") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, lf(pkt)->NumberValue() >
-                                             rf(pkt)->NumberValue());
-      });
-    } else if (op == "<") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, lf(pkt)->NumberValue() <
-                                             rf(pkt)->NumberValue());
-      });
-    } else if (op == ">=") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, lf(pkt)->NumberValue() >=
-                                             rf(pkt)->NumberValue());
-      });
-    } else if (op == "<=") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, lf(pkt)->NumberValue() <=
-                                             rf(pkt)->NumberValue());
-      });
-    } else if (op == "==") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, lf(pkt)->Equals(rf(pkt)));
-      });
-    } else if (op == "!=") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Boolean::New(isolate, !lf(pkt)->Equals(rf(pkt)));
-      });
-    } else if (op == "+") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->NumberValue() + rf(pkt)->NumberValue());
-      });
-    } else if (op == "-") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->NumberValue() + rf(pkt)->NumberValue());
-      });
-    } else if (op == "*") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->NumberValue() + rf(pkt)->NumberValue());
-      });
-    } else if (op == "/") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->NumberValue() + rf(pkt)->NumberValue());
-      });
-    } else if (op == "%") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->Int32Value() % rf(pkt)->Int32Value());
-      });
-    } else if (op == "&") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->Int32Value() & rf(pkt)->Int32Value());
-      });
-    } else if (op == "|") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->Int32Value() | rf(pkt)->Int32Value());
-      });
-    } else if (op == "^") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->Int32Value() ^ rf(pkt)->Int32Value());
-      });
-    } else if (op == ">>") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate,
-                               lf(pkt)->Int32Value() >> rf(pkt)->Int32Value());
-      });
-    } else if (op == "<<") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) {
-        return v8::Number::New(isolate, lf(pkt)->Int32Value()
-                                            << rf(pkt)->Int32Value());
-      });
+  const uint32_t id = LayerId::intern(name);
+  expr.func = [isolate, name, id](Packet *pkt) {
+    FilterValue value;
+    if (const Layer *layer = pkt->layerById(id)) {
+      value.type = FilterValue::LAYER;
+      value.layer = layer;
+    } else if (name == "$") {
+      value.type = FilterValue::PACKET;
+      value.pkt = pkt;
+    } else {
+      v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
+      v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
+      if (global->Has(key)) {
+        value = fromJS(isolate, global->Get(key));
+      }
     }
+    return value;
+  };
+  return expr;
+}
+
+Expr makeExpr(v8::Isolate *isolate, const json11::Json &json) {
+  const std::string &type = json["type"].string_value();
+
+  if (type == "MemberExpression") {
+    return makeMember(isolate, json);
+  } else if (type == "BinaryExpression") {
+    return makeBinary(isolate, json["operator"].string_value(),
+                      makeExpr(isolate, json["left"]),
+                      makeExpr(isolate, json["right"]));
   } else if (type == "Literal") {
-    const json11::Json &regex = json["regex"];
-    if (regex.is_object()) {
-      const std::string &value = json["value"].string_value();
-      return FilterFunc([isolate, value](Packet *pkt) -> v8::Local<v8::Value> {
+    if (json["regex"].is_object()) {
+      const std::string &raw = json["raw"].string_value();
+      Expr expr;
+      expr.func = [isolate, raw](Packet *pkt) {
         Nan::MaybeLocal<Nan::BoundScript> script =
-            Nan::CompileScript(v8pp::to_v8(isolate, value));
+            Nan::CompileScript(v8pp::to_v8(isolate, raw));
         if (!script.IsEmpty()) {
           Nan::MaybeLocal<v8::Value> result =
               Nan::RunScript(script.ToLocalChecked());
           if (!result.IsEmpty()) {
-            return result.ToLocalChecked();
+            return fromJS(isolate, result.ToLocalChecked());
           }
         }
-        return v8::Null(isolate);
-      });
-    } else {
-      const std::string &value = json["value"].dump();
-      return FilterFunc([isolate, value](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::json_parse(isolate, value);
-      });
+        return FilterValue();
+      };
+      return expr;
     }
-
+    const auto &value = std::make_shared<json11::Json>(json["value"]);
+    return constant(jsonValue(*value, value));
   } else if (type == "LogicalExpression") {
     const std::string &op = json["operator"].string_value();
-    const FilterFunc &lf = makeFilter(json["left"]);
-    const FilterFunc &rf = makeFilter(json["right"]);
+    const Expr &lhs = makeExpr(isolate, json["left"]);
+    const Expr &rhs = makeExpr(isolate, json["right"]);
+    if (lhs.constant) {
+      bool truthy = toBoolean(lhs.func(nullptr));
+      return (op == "||") == truthy ? lhs : rhs;
+    }
+    const ValueFunc lf = lhs.func;
+    const ValueFunc rf = rhs.func;
+    Expr expr;
     if (op == "||") {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) -> v8::Local<v8::Value> {
-        v8::Local<v8::Value> value = lf(pkt);
-        return value->BooleanValue() ? value : rf(pkt);
-      });
+      expr.func = [lf, rf](Packet *pkt) {
+        const FilterValue &value = lf(pkt);
+        return toBoolean(value) ? value : rf(pkt);
+      };
     } else {
-      return FilterFunc([isolate, lf, rf](Packet *pkt) -> v8::Local<v8::Value> {
-        v8::Local<v8::Value> value = lf(pkt);
-        return !value->BooleanValue() ? value : rf(pkt);
-      });
+      expr.func = [lf, rf](Packet *pkt) {
+        const FilterValue &value = lf(pkt);
+        return !toBoolean(value) ? value : rf(pkt);
+      };
     }
+    return expr;
   } else if (type == "UnaryExpression") {
-    const FilterFunc &func = makeFilter(json["argument"]);
+    const Expr &arg = makeExpr(isolate, json["argument"]);
+    const ValueFunc func = arg.func;
     const std::string &op = json["operator"].string_value();
     if (op == "+") {
-      return FilterFunc([isolate, func](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::to_v8(isolate, func(pkt)->NumberValue());
-      });
+      return fold(
+          [isolate, func](Packet *pkt) {
+            return numberValue(toNumber(isolate, func(pkt)));
+          },
+          {&arg});
     } else if (op == "-") {
-      return FilterFunc([isolate, func](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::to_v8(isolate, -func(pkt)->NumberValue());
-      });
+      return fold(
+          [isolate, func](Packet *pkt) {
+            return numberValue(-toNumber(isolate, func(pkt)));
+          },
+          {&arg});
     } else if (op == "!") {
-      return FilterFunc([isolate, func](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::to_v8(isolate, !func(pkt)->BooleanValue());
-      });
+      return fold(
+          [func](Packet *pkt) { return booleanValue(!toBoolean(func(pkt))); },
+          {&arg});
     } else if (op == "~") {
-      return FilterFunc([isolate, func](Packet *pkt) -> v8::Local<v8::Value> {
-        return v8pp::to_v8(isolate, ~func(pkt)->Int32Value());
-      });
+      return fold(
+          [isolate, func](Packet *pkt) {
+            return numberValue(~toInt32(toNumber(isolate, func(pkt))));
+          },
+          {&arg});
     }
   } else if (type == "CallExpression") {
-    const FilterFunc &cf = makeFilter(json["callee"]);
-    std::vector<FilterFunc> argFuncs;
-    for (const json11::Json &item : json["arguments"].array_items()) {
-      argFuncs.push_back(makeFilter(item));
+    return makeCall(isolate, json);
+  } else if (type == "ConditionalExpression") {
+    const Expr &test = makeExpr(isolate, json["test"]);
+    const Expr &consequent = makeExpr(isolate, json["consequent"]);
+    const Expr &alternate = makeExpr(isolate, json["alternate"]);
+    if (test.constant) {
+      return toBoolean(test.func(nullptr)) ? consequent : alternate;
     }
-    return FilterFunc([isolate, cf,
-                       argFuncs](Packet *pkt) -> v8::Local<v8::Value> {
-      v8::Local<v8::Value> func = cf(pkt);
-      if (func->IsFunction()) {
-        std::vector<v8::Local<v8::Value>> args;
-        for (const FilterFunc &arg : argFuncs) {
-          args.push_back(arg(pkt));
-        }
-        return func.As<v8::Object>()->CallAsFunction(
-            isolate->GetCurrentContext()->Global(), args.size(), args.data());
-      }
-      return v8::Null(isolate);
-    });
+    const ValueFunc tf = test.func;
+    const ValueFunc cf = consequent.func;
+    const ValueFunc af = alternate.func;
+    Expr expr;
+    expr.func = [tf, cf, af](Packet *pkt) {
+      return toBoolean(tf(pkt)) ? cf(pkt) : af(pkt);
+    };
+    return expr;
+  } else if (type == "Identifier") {
+    return makeIdentifier(isolate, json["name"].string_value());
+  }
+
+  return constant(FilterValue());
+}
+
+// Filters that call into JS or use regex literals are compiled into a single
+// JS function instead, so that V8 can optimize the whole predicate. Regexes
+// and strings are created once and passed in through |consts|.
+const char *const scriptPrologue =
+    "(function(consts, layer, layerAttr, cidr, global) {\n"
+    "  function ident(pkt, i, name) {\n"
+    "    var l = layer(pkt, i);\n"
+    "    if (l !== undefined) return l;\n"
+    "    if (name === '$') return pkt;\n"
+    "    return name in global ? global[name] : null;\n"
+    "  }\n"
+    "  function attr(o, name) {\n"
+    "    if (typeof o === 'string') o = Object(o);\n"
+    "    var t = typeof o;\n"
+    "    if (o === null || (t !== 'object' && t !== 'function')) return null;\n"
+    "    var v = layerAttr(o, name);\n"
+    "    if (v !== undefined) return v;\n"
+    "    return name in o ? o[name] : null;\n"
+    "  }\n"
+    "  function call(o, name, args) {\n"
+    "    var f = attr(o, name);\n"
+    "    return typeof f === 'function' ? f.apply(o, args) : null;\n"
+    "  }\n"
+    "  function apply(f, args) {\n"
+    "    return typeof f === 'function' ? f.apply(null, args) : null;\n"
+    "  }\n"
+    "  function inop(v, r) {\n"
+    "    if (typeof r === 'string') return cidr(v, r);\n"
+    "    var t = typeof r;\n"
+    "    return r !== null && (t === 'object' || t === 'function') && v in r;\n"
+    "  }\n"
+    "  return function(pkt) { return !!(";
+
+const char *const scriptEpilogue = "); };\n})";
+
+struct ScriptFilter {
+  v8::Isolate *isolate;
+  std::vector<uint32_t> ids;
+  std::vector<Layer *> layers;
+  v8::UniquePersistent<v8::Function> func;
+};
+
+bool requiresScript(const json11::Json &json) {
+  const std::string &type = json["type"].string_value();
+  if (type == "CallExpression" ||
+      (type == "Literal" && json["regex"].is_object()))
+    return true;
+  if (json.is_object()) {
+    for (const auto &pair : json.object_items()) {
+      if ((pair.second.is_object() || pair.second.is_array()) &&
+          requiresScript(pair.second))
+        return true;
+    }
+  } else if (json.is_array()) {
+    for (const json11::Json &item : json.array_items()) {
+      if (requiresScript(item))
+        return true;
+    }
+  }
+  return false;
+}
+
+class ScriptBuilder {
+public:
+  ScriptBuilder(v8::Isolate *isolate, ScriptFilter *filter)
+      : isolate(isolate), filter(filter),
+        consts(v8::Array::New(isolate)) {}
+
+  std::string build(const json11::Json &json);
+  v8::Local<v8::Array> constants() const { return consts; }
+
+private:
+  std::string constant(v8::Local<v8::Value> value);
+  std::string args(const json11::Json &json);
+
+private:
+  v8::Isolate *isolate;
+  ScriptFilter *filter;
+  v8::Local<v8::Array> consts;
+};
+
+std::string ScriptBuilder::constant(v8::Local<v8::Value> value) {
+  uint32_t index = consts->Length();
+  consts->Set(index, value);
+  return "consts[" + std::to_string(index) + "]";
+}
+
+std::string ScriptBuilder::args(const json11::Json &json) {
+  std::string code = "[";
+  for (const json11::Json &item : json["arguments"].array_items()) {
+    if (code.size() > 1)
+      code += ", ";
+    code += build(item);
+  }
+  return code + "]";
+}
+
+std::string ScriptBuilder::build(const json11::Json &json) {
+  static const std::unordered_set<std::string> binaryOps = {
+      "==", "!=", "===", "!==", "<", "<=", ">", ">=", "+", "-", "*",
+      "/",  "%",  "&",   "|",   "^", "<<", ">>", ">>>", "instanceof"};
+  static const std::unordered_set<std::string> unaryOps = {"+", "-", "!", "~",
+                                                           "typeof"};
+
+  const std::string &type = json["type"].string_value();
+  const std::string &op = json["operator"].string_value();
+
+  if (type == "MemberExpression") {
+    const json11::Json &property = json["property"];
+    std::string name;
+    if (!json["computed"].bool_value() &&
+        property["type"].string_value() == "Identifier") {
+      name = constant(v8pp::to_v8(isolate, property["name"].string_value()));
+    } else {
+      name = build(property);
+    }
+    return "attr(" + build(json["object"]) + ", " + name + ")";
+  } else if (type == "BinaryExpression" && op == "in") {
+    return "inop(" + build(json["left"]) + ", " + build(json["right"]) + ")";
+  } else if (type == "BinaryExpression" && binaryOps.count(op)) {
+    return "(" + build(json["left"]) + " " + op + " " + build(json["right"]) +
+           ")";
+  } else if (type == "LogicalExpression") {
+    return "(" + build(json["left"]) + (op == "||" ? " || " : " && ") +
+           build(json["right"]) + ")";
+  } else if (type == "UnaryExpression" && unaryOps.count(op)) {
+    return "(" + op + " " + build(json["argument"]) + ")";
   } else if (type == "ConditionalExpression") {
-    const FilterFunc &tf = makeFilter(json["test"]);
-    const FilterFunc &cf = makeFilter(json["consequent"]);
-    const FilterFunc &af = makeFilter(json["alternate"]);
-    return FilterFunc(
-        [isolate, tf, cf, af](Packet *pkt) -> v8::Local<v8::Value> {
-          return tf(pkt)->BooleanValue() ? cf(pkt) : af(pkt);
-        });
+    return "(" + build(json["test"]) + " ? " + build(json["consequent"]) +
+           " : " + build(json["alternate"]) + ")";
+  } else if (type == "Literal") {
+    const json11::Json &value = json["value"];
+    if (json["regex"].is_object()) {
+      Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
+          v8pp::to_v8(isolate, "(" + json["raw"].string_value() + ")"));
+      if (!script.IsEmpty()) {
+        Nan::MaybeLocal<v8::Value> result =
+            Nan::RunScript(script.ToLocalChecked());
+        if (!result.IsEmpty())
+          return constant(result.ToLocalChecked());
+      }
+      return "null";
+    } else if (value.is_string()) {
+      return constant(v8pp::to_v8(isolate, value.string_value()));
+    } else if (value.is_number() || value.is_bool()) {
+      return "(" + value.dump() + ")";
+    }
+    return "null";
+  } else if (type == "CallExpression") {
+    const json11::Json &callee = json["callee"];
+    const json11::Json &property = callee["property"];
+    if (callee["type"].string_value() == "MemberExpression" &&
+        !callee["computed"].bool_value() &&
+        property["type"].string_value() == "Identifier") {
+      return "call(" + build(callee["object"]) + ", " +
+             constant(v8pp::to_v8(isolate, property["name"].string_value())) +
+             ", " + args(json) + ")";
+    }
+    return "apply(" + build(callee) + ", " + args(json) + ")";
   } else if (type == "Identifier") {
     const std::string &name = json["name"].string_value();
-    return FilterFunc([isolate, name](Packet *pkt) -> v8::Local<v8::Value> {
+    if (isPacketProperty(name)) {
+      return "pkt." + name;
+    }
+    filter->ids.push_back(LayerId::intern(name));
+    return "ident(pkt, " + std::to_string(filter->ids.size() - 1) + ", " +
+           constant(v8pp::to_v8(isolate, name)) + ")";
+  }
+  return "null";
+}
 
-      v8::Local<v8::Value> key = v8pp::to_v8(isolate, name);
-      v8::Local<v8::Object> pktObject =
-          v8pp::class_<Packet>::find_object(isolate, pkt);
-      if (pktObject.IsEmpty()) {
-        pktObject = v8pp::class_<Packet>::reference_external(isolate, pkt);
-      }
-      if (pktObject->Has(key)) {
-        return pktObject->Get(key);
-      }
+FilterFunc makeScriptFilter(v8::Isolate *isolate, const json11::Json &json) {
+  const auto &filter = std::make_shared<ScriptFilter>();
+  filter->isolate = isolate;
 
-      std::function<std::shared_ptr<Layer>(
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>> &)>
-          findLayer;
-      findLayer = [&findLayer](
-          const std::string &name,
-          const std::unordered_map<std::string, std::shared_ptr<Layer>>
-              &layers) {
-        for (const auto &pair : layers) {
-          if (pair.second->id() == name) {
-            return pair.second;
-          }
-        }
-        for (const auto &pair : layers) {
-          const std::shared_ptr<Layer> &layer =
-              findLayer(name, pair.second->layers());
-          if (layer) {
-            return layer;
-          }
-        }
-        return std::shared_ptr<Layer>();
-      };
-      if (const std::shared_ptr<Layer> &layer =
-              findLayer(name, pkt->layers())) {
-        return v8pp::class_<Layer>::reference_external(isolate, layer.get());
-      }
-      if (name == "$") {
-        return pktObject;
-      }
-      v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
-      if (global->Has(key)) {
-        return global->Get(key);
-      }
-      return v8::Null(isolate);
-    });
+  ScriptBuilder builder(isolate, filter.get());
+  const std::string &source =
+      scriptPrologue + builder.build(json) + scriptEpilogue;
+
+  v8::Local<v8::External> data = v8::External::New(isolate, filter.get());
+  v8::Local<v8::Function> layer =
+      v8::FunctionTemplate::New(
+          isolate,
+          [](v8::FunctionCallbackInfo<v8::Value> const &args) {
+            v8::Isolate *isolate = v8::Isolate::GetCurrent();
+            ScriptFilter *filter = static_cast<ScriptFilter *>(
+                args.Data().As<v8::External>()->Value());
+            Packet *pkt = v8pp::class_<Packet>::unwrap_object(isolate, args[0]);
+            uint32_t index = v8pp::from_v8<uint32_t>(isolate, args[1], 0);
+            if (!pkt || index >= filter->ids.size())
+              return;
+            if (const Layer *found = pkt->layerById(filter->ids[index])) {
+              Layer *layer = const_cast<Layer *>(found);
+              v8::Local<v8::Object> obj =
+                  v8pp::class_<Layer>::find_object(isolate, layer);
+              if (obj.IsEmpty()) {
+                obj = v8pp::class_<Layer>::reference_external(isolate, layer);
+                filter->layers.push_back(layer);
+              }
+              args.GetReturnValue().Set(obj);
+            }
+          },
+          data)
+          ->GetFunction();
+  v8::Local<v8::Function> layerAttr =
+      v8::FunctionTemplate::New(
+          isolate, [](v8::FunctionCallbackInfo<v8::Value> const &args) {
+            v8::Isolate *isolate = v8::Isolate::GetCurrent();
+            if (const Layer *layer =
+                    v8pp::class_<Layer>::unwrap_object(isolate, args[0])) {
+              const std::string &name =
+                  v8pp::from_v8<std::string>(isolate, args[1], "");
+              const auto &attrs = layer->attrs();
+              const auto it = attrs.find(name);
+              if (it != attrs.end()) {
+                args.GetReturnValue().Set(it->second.data());
+              }
+            }
+          })
+          ->GetFunction();
+  v8::Local<v8::Function> cidr =
+      v8::FunctionTemplate::New(
+          isolate, [](v8::FunctionCallbackInfo<v8::Value> const &args) {
+            v8::Isolate *isolate = v8::Isolate::GetCurrent();
+            std::string network;
+            size_t prefix;
+            std::string bytes;
+            args.GetReturnValue().Set(
+                args[0]->IsString() &&
+                Address::parseNetwork(
+                    v8pp::from_v8<std::string>(isolate, args[1], ""),
+                    &network, &prefix) &&
+                Address::parse(v8pp::from_v8<std::string>(isolate, args[0]),
+                               &bytes) &&
+                Address::inNetwork(bytes.data(), bytes.size(), network,
+                                   prefix));
+          })
+          ->GetFunction();
+
+  Nan::MaybeLocal<Nan::BoundScript> script =
+      CodeCache::compile(isolate, source, "filter");
+  if (script.IsEmpty())
+    return FilterFunc();
+  Nan::MaybeLocal<v8::Value> factory = Nan::RunScript(script.ToLocalChecked());
+  if (factory.IsEmpty() || !factory.ToLocalChecked()->IsFunction())
+    return FilterFunc();
+
+  v8::Local<v8::Value> args[5] = {builder.constants(), layer, layerAttr, cidr,
+                                  isolate->GetCurrentContext()->Global()};
+  v8::Local<v8::Value> func =
+      factory.ToLocalChecked().As<v8::Function>()->Call(
+          isolate->GetCurrentContext()->Global(), 5, args);
+  if (func.IsEmpty() || !func->IsFunction())
+    return FilterFunc();
+  filter->func.Reset(isolate, func.As<v8::Function>());
+
+  return FilterFunc([filter](Packet *pkt) {
+    v8::Isolate *isolate = filter->isolate;
+    v8::Local<v8::Object> pktObject =
+        v8pp::class_<Packet>::find_object(isolate, pkt);
+    bool referenced = pktObject.IsEmpty();
+    if (referenced) {
+      pktObject = v8pp::class_<Packet>::reference_external(isolate, pkt);
+    }
+
+    v8::Local<v8::Function> func =
+        v8::Local<v8::Function>::New(isolate, filter->func);
+    v8::Local<v8::Value> args[1] = {pktObject};
+    v8::Local<v8::Value> result =
+        func->Call(isolate->GetCurrentContext()->Global(), 1, args);
+
+    for (Layer *layer : filter->layers) {
+      v8pp::class_<Layer>::unreference_external(isolate, layer);
+    }
+    filter->layers.clear();
+    if (referenced) {
+      v8pp::class_<Packet>::unreference_external(isolate, pkt);
+    }
+    return !result.IsEmpty() && result->BooleanValue();
+  });
+}
+
+bool isLayerIdentifier(v8::Isolate *isolate, const json11::Json &json) {
+  if (json["type"].string_value() != "Identifier")
+    return false;
+  const std::string &name = json["name"].string_value();
+  if (isPacketProperty(name) || name == "$")
+    return false;
+  v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
+  return !global->Has(v8pp::to_v8(isolate, name));
+}
+
+// Layer ids whose absence makes |json| evaluate to null. Member reads on a
+// missing layer stay null, so this follows the object side of members.
+std::set<uint32_t> nullIfMissing(v8::Isolate *isolate,
+                                 const json11::Json &json) {
+  const std::string &type = json["type"].string_value();
+  if (type == "MemberExpression") {
+    return nullIfMissing(isolate, json["object"]);
+  } else if (isLayerIdentifier(isolate, json)) {
+    return std::set<uint32_t>{LayerId::intern(json["name"].string_value())};
   }
+  return std::set<uint32_t>();
+}
+
+bool isNonNullLiteral(const json11::Json &json) {
+  return json["type"].string_value() == "Literal" &&
+         (!json["value"].is_null() || json["regex"].is_object());
+}
 
-  return FilterFunc([isolate](Packet *) { return v8::Null(isolate); });
+// Layer ids whose absence makes |json| falsy regardless of anything else.
+std::set<uint32_t> falseIfMissing(v8::Isolate *isolate,
+                                  const json11::Json &json) {
+  const std::string &type = json["type"].string_value();
+  const std::string &op = json["operator"].string_value();
+  std::set<uint32_t> ids = nullIfMissing(isolate, json);
+
+  if (type == "LogicalExpression") {
+    const std::set<uint32_t> &lhs = falseIfMissing(isolate, json["left"]);
+    const std::set<uint32_t> &rhs = falseIfMissing(isolate, json["right"]);
+    if (op == "&&") {
+      ids.insert(lhs.begin(), lhs.end());
+      ids.insert(rhs.begin(), rhs.end());
+    } else {
+      std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                            std::inserter(ids, ids.end()));
+    }
+  } else if (type == "BinaryExpression" &&
+             (op == "==" || op == "===")) {
+    if (isNonNullLiteral(json["right"])) {
+      const std::set<uint32_t> &lhs = nullIfMissing(isolate, json["left"]);
+      ids.insert(lhs.begin(), lhs.end());
+    }
+    if (isNonNullLiteral(json["left"])) {
+      const std::set<uint32_t> &rhs = nullIfMissing(isolate, json["right"]);
+      ids.insert(rhs.begin(), rhs.end());
+    }
+  }
+  return ids;
+}
+// Matches `layer.attr == 'value'` in either operand order. Names that the
+// layer object resolves itself never reach the attribute index.
+bool indexTerm(v8::Isolate *isolate, const json11::Json &member,
+               const json11::Json &literal, FilterIndexTerm *term) {
+  static const std::unordered_set<std::string> layerProps = {
+      "namespace", "name",  "id",    "summary", "range",
+      "payload",   "items", "attrs", "layers"};
+  if (member["type"].string_value() != "MemberExpression" ||
+      member["computed"].bool_value() ||
+      !isLayerIdentifier(isolate, member["object"]))
+    return false;
+  if (literal["type"].string_value() != "Literal" ||
+      !literal["value"].is_string())
+    return false;
+  const std::string &attr = member["property"]["name"].string_value();
+  if (attr.empty() || layerProps.count(attr))
+    return false;
+  term->layerId = LayerId::intern(member["object"]["name"].string_value());
+  term->attr = attr;
+  term->value = literal["value"].string_value();
+  return true;
+}
+
+bool literalNumber(const json11::Json &json, double *number) {
+  const std::string &type = json["type"].string_value();
+  if (type == "UnaryExpression" && json["operator"].string_value() == "-") {
+    if (!literalNumber(json["argument"], number))
+      return false;
+    *number = -*number;
+    return true;
+  }
+  if (type != "Literal" || !json["value"].is_number())
+    return false;
+  *number = json["value"].number_value();
+  return true;
+}
+
+// Accepts 'str', Buffer.from('str'[, enc]) and new Buffer('str'[, enc]).
+bool literalBytes(const json11::Json &json, std::string *bytes) {
+  const std::string &type = json["type"].string_value();
+  if (type == "Literal") {
+    if (!json["value"].is_string())
+      return false;
+    *bytes = json["value"].string_value();
+    return true;
+  }
+
+  const json11::Json &callee = json["callee"];
+  if (type == "CallExpression") {
+    if (callee["type"].string_value() != "MemberExpression" ||
+        callee["computed"].bool_value() ||
+        callee["object"]["name"].string_value() != "Buffer" ||
+        callee["property"]["name"].string_value() != "from")
+      return false;
+  } else if (type != "NewExpression" ||
+             callee["name"].string_value() != "Buffer") {
+    return false;
+  }
+
+  const auto &args = json["arguments"].array_items();
+  if (args.empty() || args.size() > 2 ||
+      args[0]["type"].string_value() != "Literal" ||
+      !args[0]["value"].is_string())
+    return false;
+  const std::string &str = args[0]["value"].string_value();
+  std::string encoding = "utf8";
+  if (args.size() == 2) {
+    if (args[1]["type"].string_value() != "Literal")
+      return false;
+    encoding = args[1]["value"].string_value();
+  }
+
+  if (encoding == "utf8") {
+    *bytes = str;
+    return true;
+  } else if (encoding == "hex" && str.size() % 2 == 0) {
+    bytes->clear();
+    for (size_t i = 0; i < str.size(); i += 2) {
+      if (!std::isxdigit(static_cast<unsigned char>(str[i])) ||
+          !std::isxdigit(static_cast<unsigned char>(str[i + 1])))
+        return false;
+      bytes->push_back(std::strtoul(str.substr(i, 2).c_str(), nullptr, 16));
+    }
+    return true;
+  }
+  return false;
+}
+
+// Matches `payload.indexOf(bytes) >= 0` and its `> -1` / `!== -1` forms.
+bool payloadTerm(const json11::Json &json, std::string *bytes) {
+  const std::string &op = json["operator"].string_value();
+  const json11::Json &call = json["left"];
+  const json11::Json &callee = call["callee"];
+  double rhs;
+  if (json["type"].string_value() != "BinaryExpression" ||
+      !literalNumber(json["right"], &rhs))
+    return false;
+  if (!((op == ">=" && rhs == 0) || (op == ">" && rhs == -1) ||
+        ((op == "!=" || op == "!==") && rhs == -1)))
+    return false;
+  if (call["type"].string_value() != "CallExpression" ||
+      callee["type"].string_value() != "MemberExpression" ||
+      callee["computed"].bool_value() ||
+      callee["object"]["type"].string_value() != "Identifier" ||
+      callee["object"]["name"].string_value() != "payload" ||
+      callee["property"]["name"].string_value() != "indexOf")
+    return false;
+  const auto &args = call["arguments"].array_items();
+  return args.size() == 1 && literalBytes(args[0], bytes);
+}
+
+void collectPayloadTerms(const json11::Json &json,
+                         std::vector<std::string> *terms) {
+  if (json["type"].string_value() == "LogicalExpression" &&
+      json["operator"].string_value() == "&&") {
+    collectPayloadTerms(json["left"], terms);
+    collectPayloadTerms(json["right"], terms);
+    return;
+  }
+  std::string bytes;
+  if (payloadTerm(json, &bytes))
+    terms->push_back(bytes);
+}
+
+void collectIndexTerms(v8::Isolate *isolate, const json11::Json &json,
+                       std::vector<FilterIndexTerm> *terms) {
+  const std::string &type = json["type"].string_value();
+  const std::string &op = json["operator"].string_value();
+  if (type == "LogicalExpression" && op == "&&") {
+    collectIndexTerms(isolate, json["left"], terms);
+    collectIndexTerms(isolate, json["right"], terms);
+  } else if (type == "BinaryExpression" && (op == "==" || op == "===")) {
+    FilterIndexTerm term;
+    if (indexTerm(isolate, json["left"], json["right"], &term) ||
+        indexTerm(isolate, json["right"], json["left"], &term))
+      terms->push_back(term);
+  }
+}
 }
 
 FilterFunc makeFilter(const std::string &jsonstr) {
   std::string err;
   json11::Json json = json11::Json::parse(jsonstr, err);
-  return makeFilter(json);
+  v8::Isolate *isolate = v8::Isolate::GetCurrent();
+  FilterFunc func;
+  if (requiresScript(json)) {
+    func = makeScriptFilter(isolate, json);
+  }
+  if (!func) {
+    const ValueFunc valueFunc = makeExpr(isolate, json).func;
+    func = [valueFunc](Packet *pkt) { return toBoolean(valueFunc(pkt)); };
+  }
+
+  uint64_t mask = 0;
+  for (uint32_t id : falseIfMissing(isolate, json)) {
+    mask |= LayerId::bit(id);
+  }
+  if (mask == 0)
+    return func;
+  return FilterFunc([func, mask](Packet *pkt) {
+    return (pkt->layerMask() & mask) == mask && func(pkt);
+  });
+}
+
+std::vector<FilterIndexTerm> filterIndexTerms(const std::string &jsonstr) {
+  std::string err;
+  json11::Json json = json11::Json::parse(jsonstr, err);
+  std::vector<FilterIndexTerm> terms;
+  collectIndexTerms(v8::Isolate::GetCurrent(), json, &terms);
+  return terms;
+}
+
+std::vector<std::string> filterPayloadTerms(const std::string &jsonstr) {
+  std::string err;
+  json11::Json json = json11::Json::parse(jsonstr, err);
+  std::vector<std::string> terms;
+  collectPayloadTerms(json, &terms);
+  return terms;
 }
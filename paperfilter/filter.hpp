@@ -3,11 +3,26 @@
 
 #include <v8.h>
 #include <functional>
+#include <string>
+#include <vector>
 
 class Packet;
 
-typedef std::function<v8::Local<v8::Value>(Packet *)> FilterFunc;
+typedef std::function<bool(Packet *)> FilterFunc;
 
 FilterFunc makeFilter(const std::string &jsonstr);
 
+struct FilterIndexTerm {
+  uint32_t layerId;
+  std::string attr;
+  std::string value;
+};
+
+// Conjuncts of the form `layer.attr == 'value'`; every matching packet
+// satisfies all of them.
+std::vector<FilterIndexTerm> filterIndexTerms(const std::string &jsonstr);
+
+// Byte strings that `payload.indexOf(...) >= 0` conjuncts require.
+std::vector<std::string> filterPayloadTerms(const std::string &jsonstr);
+
 #endif
@@ -3,9 +3,12 @@
 #include "packet.hpp"
 #include "packet_store.hpp"
 #include "paper_context.hpp"
+#include "payload_index.hpp"
 #include "console.hpp"
 #include "filter.hpp"
+#include <algorithm>
 #include <cstdlib>
+#include <iterator>
 #include <nan.h>
 #include <thread>
 #include <v8pp/class.hpp>
@@ -21,21 +24,131 @@ public:
   virtual void *AllocateUninitialized(size_t size) { return malloc(size); }
   virtual void Free(void *data, size_t) { free(data); }
 };
+
+// A claimed range is packed into 64 bits as (next << 32 | end) so that the
+// owner can advance |next| while other workers shrink |end| without locking.
+const uint32_t minStealSize = 16;
+
+// Chunks answered from the attribute index only evaluate candidates, so they
+// can be much larger than scanned ones.
+const uint32_t indexedChunkSize = 1 << 20;
+
+uint64_t packRange(uint32_t next, uint32_t end) {
+  return (static_cast<uint64_t>(next) << 32) | end;
+}
+
+bool claimSeq(std::atomic<uint64_t> *range, uint32_t *seq) {
+  uint64_t value = range->load();
+  while (true) {
+    uint32_t next = value >> 32;
+    uint32_t end = value & 0xffffffff;
+    if (next >= end)
+      return false;
+    if (range->compare_exchange_weak(value, packRange(next + 1, end))) {
+      *seq = next;
+      return true;
+    }
+  }
+}
+
+bool stealRange(const std::vector<std::atomic<uint64_t> *> &ranges,
+                uint32_t *start, uint32_t *end) {
+  while (true) {
+    std::atomic<uint64_t> *victim = nullptr;
+    uint64_t value = 0;
+    uint32_t remain = 0;
+    for (std::atomic<uint64_t> *range : ranges) {
+      uint64_t v = range->load();
+      uint32_t next = v >> 32;
+      uint32_t e = v & 0xffffffff;
+      if (next < e && e - next > remain) {
+        victim = range;
+        value = v;
+        remain = e - next;
+      }
+    }
+    if (!victim || remain < minStealSize * 2)
+      return false;
+
+    uint32_t next = value >> 32;
+    uint32_t e = value & 0xffffffff;
+    uint32_t mid = next + remain / 2;
+    if (victim->compare_exchange_strong(value, packRange(next, mid))) {
+      *start = mid;
+      *end = e;
+      return true;
+    }
+  }
+}
+
+void intersect(std::vector<uint32_t> *seqs, std::vector<uint32_t> matched,
+               bool first) {
+  if (first) {
+    seqs->swap(matched);
+    return;
+  }
+  std::vector<uint32_t> both;
+  std::set_intersection(seqs->begin(), seqs->end(), matched.begin(),
+                        matched.end(), std::back_inserter(both));
+  seqs->swap(both);
+}
+
+std::vector<uint32_t> lookupTerms(const PacketStore &store,
+                                  const std::vector<FilterIndexTerm> &terms,
+                                  const std::vector<std::string> &needles,
+                                  uint32_t start, uint32_t end) {
+  std::vector<uint32_t> seqs;
+  bool first = true;
+  for (const FilterIndexTerm &term : terms) {
+    intersect(&seqs,
+              store.lookup(term.layerId, term.attr, term.value, start, end),
+              first);
+    first = false;
+    if (seqs.empty())
+      return seqs;
+  }
+  for (const std::string &needle : needles) {
+    intersect(&seqs, store.lookupPayload(needle, start, end), first);
+    first = false;
+    if (seqs.empty())
+      return seqs;
+  }
+  return seqs;
+}
+
+bool hasStealable(const std::vector<std::atomic<uint64_t> *> &ranges) {
+  for (std::atomic<uint64_t> *range : ranges) {
+    uint64_t v = range->load();
+    uint32_t next = v >> 32;
+    uint32_t end = v & 0xffffffff;
+    if (next < end && end - next >= minStealSize * 2)
+      return true;
+  }
+  return false;
+}
 }
 
 class FilterThread::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
   ~Private();
+  bool match(const FilterFunc &func, Packet *pkt);
 
 public:
   std::thread thread;
   std::shared_ptr<Context> ctx;
+  std::atomic<uint64_t> range;
   int storeHandlerId;
+  std::shared_ptr<Watchdog::Slot> slot;
   bool closed = false;
 };
 
-FilterThread::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {
+FilterThread::Private::Private(const std::shared_ptr<Context> &ctx)
+    : ctx(ctx), range(0) {
+  {
+    std::lock_guard<std::mutex> lock(ctx->mutex);
+    ctx->ranges.push_back(&range);
+  }
   storeHandlerId = ctx->store->addHandler(
       [this](uint32_t maxSeq) { this->ctx->cond.notify_all(); });
 
@@ -57,6 +170,8 @@ FilterThread::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {
       v8::Context::Scope context_scope(context);
       v8::TryCatch try_catch;
       PaperContext::init(isolate);
+      slot = ctx.watchdog ? ctx.watchdog->watch(isolate)
+                          : std::make_shared<Watchdog::Slot>(isolate, 0);
 
       v8::Local<v8::Object> console =
           v8pp::class_<Console>::create_object(isolate, ctx.logCb, "filter");
@@ -64,25 +179,77 @@ FilterThread::Private::Private(const std::shared_ptr<Context> &ctx) : ctx(ctx) {
           v8pp::to_v8(isolate, "console"), console);
 
       const FilterFunc &func = makeFilter(ctx.filter);
+      std::vector<FilterIndexTerm> terms = filterIndexTerms(ctx.filter);
+      terms.erase(std::remove_if(terms.begin(), terms.end(),
+                                 [&ctx](const FilterIndexTerm &term) {
+                                   return !ctx.store->isIndexedAttr(term.attr);
+                                 }),
+                  terms.end());
+      std::vector<std::string> needles;
+      if (ctx.store->isPayloadIndexed()) {
+        for (const std::string &needle : filterPayloadTerms(ctx.filter)) {
+          if (PayloadIndex::isIndexable(needle))
+            needles.push_back(needle);
+        }
+      }
+      const bool indexed = !terms.empty() || !needles.empty();
 
       while (true) {
-        std::unique_lock<std::mutex> lock(ctx.mutex);
-        ctx.cond.wait(lock, [this, &ctx] {
-          return ctx.maxSeq < ctx.store->maxSeq() || closed;
-        });
-        if (closed)
-          break;
-        if (ctx.maxSeq < ctx.store->maxSeq()) {
-          uint32_t seq = ++ctx.maxSeq;
-          lock.unlock();
-          const std::shared_ptr<Packet> &pkt = ctx.store->get(seq);
-          v8::Local<v8::Value> result = func(pkt.get());
-          lock.lock();
-          ctx.packets.insert(pkt->seq(), result->BooleanValue());
+        uint32_t start = 0;
+        uint32_t end = 0;
+        {
+          std::unique_lock<std::mutex> lock(ctx.mutex);
+          ctx.cond.wait(lock, [this, &ctx] {
+            return ctx.maxSeq < ctx.store->maxSeq() ||
+                   hasStealable(ctx.ranges) || closed;
+          });
+          if (closed)
+            break;
+          uint32_t storeMaxSeq = ctx.store->maxSeq();
+          if (ctx.maxSeq < storeMaxSeq) {
+            uint32_t chunkSize = indexed ? indexedChunkSize : ctx.chunkSize;
+            start = ctx.maxSeq + 1;
+            end = std::min(storeMaxSeq, ctx.maxSeq + chunkSize) + 1;
+            ctx.maxSeq = end - 1;
+          } else if (!stealRange(ctx.ranges, &start, &end)) {
+            continue;
+          }
+          if (!indexed)
+            range.store(packRange(start, end));
         }
+
+        if (indexed) {
+          v8::HandleScope chunk_scope(isolate);
+          std::vector<uint32_t> matches;
+          for (uint32_t seq : lookupTerms(*ctx.store, terms, needles, start,
+                                          end - 1)) {
+            const std::shared_ptr<Packet> &pkt = ctx.store->get(seq);
+            if (pkt && match(func, pkt.get()))
+              matches.push_back(seq);
+          }
+          ctx.packets.insert(start, end - 1, matches);
+          continue;
+        }
+
+        if (end - start >= minStealSize * 2)
+          ctx.cond.notify_all();
+
+        v8::HandleScope chunk_scope(isolate);
+        const std::vector<std::shared_ptr<Packet>> &packets =
+            ctx.store->get(start, end - 1);
+        std::vector<bool> results;
+        results.reserve(packets.size());
+        uint32_t seq;
+        for (const std::shared_ptr<Packet> &pkt : packets) {
+          if (!claimSeq(&range, &seq))
+            break;
+          results.push_back(match(func, pkt.get()));
+        }
+        ctx.packets.insert(start, results);
       }
     }
 
+    slot.reset();
     isolate->Dispose();
   });
 }
@@ -96,6 +263,29 @@ FilterThread::Private::~Private() {
   }
   if (thread.joinable())
     thread.join();
+  {
+    std::lock_guard<std::mutex> lock(this->ctx->mutex);
+    auto &ranges = this->ctx->ranges;
+    ranges.erase(std::remove(ranges.begin(), ranges.end(), &range),
+                 ranges.end());
+  }
+}
+
+bool FilterThread::Private::match(const FilterFunc &func, Packet *pkt) {
+  slot->arm();
+  const bool matched = func(pkt);
+  if (!slot->disarm())
+    return matched;
+  if (ctx->logCb) {
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_ERROR;
+    msg.message = "Timed out after " +
+                  std::to_string(ctx->watchdog->timeout()) + " ms on packet #" +
+                  std::to_string(pkt->seq());
+    msg.domain = "filter";
+    ctx->logCb(msg);
+  }
+  return false;
 }
 
 FilterThread::FilterThread(const std::shared_ptr<Context> &ctx)
@@ -2,6 +2,8 @@
 #define FILTER_THREAD_HPP
 
 #include "filtered_packet_store.hpp"
+#include "watchdog.hpp"
+#include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <memory>
@@ -19,11 +21,15 @@ public:
     std::mutex mutex;
     std::condition_variable cond;
     uint32_t maxSeq = 0;
+    uint32_t chunkSize = 256;
+    std::vector<std::atomic<uint64_t> *> ranges;
     PacketStore *store = nullptr;
     FilteredPacketStore packets;
     std::string filter;
     std::string script;
     std::function<void(const LogMessage &)> logCb;
+    // A packet whose filter call times out does not match.
+    std::shared_ptr<Watchdog> watchdog;
   };
 
 public:
@@ -7,6 +7,7 @@ class FilteredPacketStore::Private {
 public:
   Private();
   ~Private();
+  void flush();
 
 public:
   uv_rwlock_t rwlock;
@@ -45,26 +46,79 @@ uint32_t FilteredPacketStore::get(uint32_t index) const {
   return seq;
 }
 
+void FilteredPacketStore::Private::flush() {
+  uint32_t seq = maxSeq;
+  for (auto it = queue.find(seq + 1); it != queue.end();
+       it = queue.find(++seq + 1)) {
+    if (it->second) {
+      packets.push_back(it->first);
+    }
+  }
+  if (maxSeq < seq) {
+    maxSeq = seq;
+    queue.erase(queue.begin(), queue.upper_bound(seq));
+    for (const auto &pair : handlers) {
+      if (pair.second)
+        pair.second(packets.size());
+    }
+  }
+}
+
 void FilteredPacketStore::insert(uint32_t seq, bool match) {
   uv_rwlock_wrlock(&d->rwlock);
   d->queue[seq] = match;
-  uint32_t maxSeq = d->maxSeq;
-  auto end = d->queue.begin();
-  for (auto it = d->queue.find(maxSeq + 1); it != d->queue.end();
-       end = it, it = d->queue.find(++maxSeq + 1)) {
-    if (it->second) {
-      d->packets.push_back(it->first);
+  d->flush();
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+void FilteredPacketStore::insert(uint32_t start,
+                                 const std::vector<bool> &matches) {
+  if (matches.empty())
+    return;
+  uv_rwlock_wrlock(&d->rwlock);
+  if (start == d->maxSeq + 1 && d->queue.empty()) {
+    for (size_t i = 0; i < matches.size(); ++i) {
+      if (matches[i])
+        d->packets.push_back(start + i);
     }
+    d->maxSeq = start + matches.size() - 1;
+    for (const auto &pair : d->handlers) {
+      if (pair.second)
+        pair.second(d->packets.size());
+    }
+  } else {
+    auto hint = d->queue.end();
+    for (size_t i = 0; i < matches.size(); ++i) {
+      hint = d->queue.emplace_hint(hint, start + i, matches[i]);
+      ++hint;
+    }
+    d->flush();
   }
-  if (d->maxSeq < maxSeq) {
-    d->maxSeq = maxSeq;
-    d->queue.erase(d->queue.begin(), end);
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+void FilteredPacketStore::insert(uint32_t start, uint32_t end,
+                                 const std::vector<uint32_t> &matches) {
+  if (start > end)
+    return;
+  uv_rwlock_wrlock(&d->rwlock);
+  if (start == d->maxSeq + 1 && d->queue.empty()) {
+    d->packets.insert(d->packets.end(), matches.begin(), matches.end());
+    d->maxSeq = end;
     for (const auto &pair : d->handlers) {
       if (pair.second)
         pair.second(d->packets.size());
     }
+    uv_rwlock_wrunlock(&d->rwlock);
+    return;
   }
   uv_rwlock_wrunlock(&d->rwlock);
+
+  std::vector<bool> results(end - start + 1);
+  for (uint32_t seq : matches) {
+    results[seq - start] = true;
+  }
+  insert(start, results);
 }
 
 uint32_t FilteredPacketStore::size() const {
@@ -12,6 +12,9 @@ public:
   FilteredPacketStore(const FilteredPacketStore &) = delete;
   FilteredPacketStore &operator=(const FilteredPacketStore &) = delete;
   void insert(uint32_t seq, bool match);
+  void insert(uint32_t start, const std::vector<bool> &matches);
+  void insert(uint32_t start, uint32_t end,
+              const std::vector<uint32_t> &matches);
   std::vector<uint32_t> get(uint32_t start, uint32_t end) const;
   uint32_t get(uint32_t index) const;
   uint32_t size() const;
@@ -1,4 +1,8 @@
 const EventEmitter = require('events');
+const crypto = require('crypto');
+const fs = require('fs');
+const path = require('path');
+const rollupVersion = require('rollup').VERSION;
 const rollup = require('rollup').rollup;
 const nodeResolve = require('rollup-plugin-node-resolve');
 const commonjs = require('rollup-plugin-commonjs');
@@ -13,7 +17,92 @@ try {
   console.warn(e);
 }
 
-function roll(script) {
+function hashFile(file) {
+  try {
+    return crypto.createHash('sha1').update(fs.readFileSync(file)).digest('hex');
+  } catch (e) {
+    return null;
+  }
+}
+
+function bundleCachePath(cacheDir, script) {
+  const key = crypto.createHash('sha1')
+    .update(rollupVersion + '\0' + path.resolve(script))
+    .digest('hex');
+  return path.join(cacheDir, key + '.json');
+}
+
+// A cached bundle is reused only while every file that went into it still
+// has the same content.
+function readBundleCache(cacheDir, script) {
+  try {
+    const entry = JSON.parse(
+      fs.readFileSync(bundleCachePath(cacheDir, script), 'utf8'));
+    for (let file in entry.files) {
+      if (hashFile(file) !== entry.files[file]) {
+        return null;
+      }
+    }
+    return entry.code;
+  } catch (e) {
+    return null;
+  }
+}
+
+function writeBundleCache(cacheDir, script, files, code) {
+  const cachePath = bundleCachePath(cacheDir, script);
+  const tmpPath = cachePath + '.' + process.pid;
+  try {
+    fs.writeFileSync(tmpPath, JSON.stringify({ files, code }));
+    fs.renameSync(tmpPath, cachePath);
+  } catch (e) {
+    console.warn(e);
+  }
+}
+
+function nativeDissector(script, name, source = '') {
+  return {
+    script: source,
+    native: name,
+    resourceName: script
+  };
+}
+
+// Field tables (.json) are compiled by the native "table" dissector and
+// WebAssembly modules (.wasm) are passed as bytes; other scripts are
+// bundled unless a native implementation is named.
+function loadDissector(script, native, cacheDir) {
+  if (Session.hasNativeDissector(native)) {
+    return Promise.resolve(nativeDissector(script, native));
+  }
+  if (path.extname(script) === '.json') {
+    return Promise.resolve().then(() => {
+      return nativeDissector(script, 'table', fs.readFileSync(script, 'utf8'));
+    });
+  }
+  if (path.extname(script) === '.wasm') {
+    return Promise.resolve().then(() => {
+      return {
+        script: fs.readFileSync(script),
+        resourceName: script
+      };
+    });
+  }
+  return roll(script, cacheDir).then((code) => {
+    return {
+      script: code,
+      resourceName: script
+    };
+  });
+}
+
+function roll(script, cacheDir) {
+  if (cacheDir) {
+    const code = readBundleCache(cacheDir, script);
+    if (code != null) {
+      return Promise.resolve(code);
+    }
+  }
   return rollup({
     entry: script,
     external: ['dripcap'],
@@ -31,6 +120,15 @@ function roll(script) {
     const result = bundle.generate({
       format: 'cjs'
     });
+    if (cacheDir) {
+      let files = {};
+      for (let mod of bundle.modules) {
+        if (path.isAbsolute(mod.id)) {
+          files[mod.id] = hashFile(mod.id);
+        }
+      }
+      writeBundleCache(cacheDir, script, files, result.code);
+    }
     return result.code;
   });
 }
@@ -54,11 +152,39 @@ class Session extends EventEmitter {
     this._sess.statusCallback = (stat) => {
       this.emit('status', stat);
     };
+    // A failed load is also reported through the log callback.
     this._reset = _.debounce(() => {
-      this._sess.reset(this._option);
+      this.reset().catch(() => {});
     }, 100);
   }
 
+  // Resolves once the old pipeline has been drained and the new dissectors
+  // are loaded; the work happens off the main thread. Rejects if the
+  // dissectors do not load in time.
+  reset() {
+    return new Promise((resolve, reject) => {
+      this._sess.reset(this._option, (err) => {
+        if (err == null) {
+          resolve();
+        } else {
+          reject(new Error(err));
+        }
+      });
+    });
+  }
+
+  ready() {
+    return new Promise((resolve, reject) => {
+      this._sess.ready((err) => {
+        if (err == null) {
+          resolve();
+        } else {
+          reject(new Error(err));
+        }
+      });
+    });
+  }
+
   static create(option) {
     let sessOption = {
       namespace: option.namespace,
@@ -66,20 +192,46 @@ class Session extends EventEmitter {
       stream_dissectors: []
     };
 
+    if (Array.isArray(option.indexed_attrs)) {
+      sessOption.indexed_attrs = option.indexed_attrs;
+    }
+    if (option.payload_index) {
+      sessOption.payload_index = true;
+    }
+    if (typeof option.code_cache === 'string') {
+      sessOption.code_cache = option.code_cache;
+    }
+    if (typeof option.bundle_cache === 'string') {
+      sessOption.bundle_cache = option.bundle_cache;
+    }
+    if (Number.isInteger(option.queue_limit)) {
+      sessOption.queue_limit = option.queue_limit;
+    }
+    if (Number.isInteger(option.queue_limit_bytes)) {
+      sessOption.queue_limit_bytes = option.queue_limit_bytes;
+    }
+    if (Number.isInteger(option.script_timeout)) {
+      sessOption.script_timeout = option.script_timeout;
+    }
+    if (Number.isInteger(option.script_timeout_limit)) {
+      sessOption.script_timeout_limit = option.script_timeout_limit;
+    }
+    if (['block', 'drop', 'raw'].includes(option.overflow_policy)) {
+      sessOption.overflow_policy = option.overflow_policy;
+    }
+
     let tasks = [];
     if (Array.isArray(option.dissectors)) {
       for (let diss of option.dissectors) {
-        tasks.push(roll(diss.script).then((code) => {
-          sessOption.dissectors.push({
-            script: code,
-            resourceName: diss.script
-          });
+        tasks.push(loadDissector(diss.script, diss.native,
+          sessOption.bundle_cache).then((loaded) => {
+          sessOption.dissectors.push(loaded);
         }));
       }
     }
     if (Array.isArray(option.stream_dissectors)) {
       for (let diss of option.stream_dissectors) {
-        tasks.push(roll(diss.script).then((code) => {
+        tasks.push(roll(diss.script, sessOption.bundle_cache).then((code) => {
           sessOption.stream_dissectors.push({
             script: code,
             resourceName: diss.script
@@ -88,7 +240,8 @@ class Session extends EventEmitter {
       }
     }
     return Promise.all(tasks).then(() => {
-      return new Session(sessOption);
+      const sess = new Session(sessOption);
+      return sess.ready().then(() => sess);
     });
   }
 
@@ -122,6 +275,12 @@ class Session extends EventEmitter {
     return this._sess.getFiltered(name, start, end);
   }
 
+  // Invocation counts, times in milliseconds, errors and emitted layers and
+  // chunks for each dissector on each thread.
+  stats() {
+    return this._sess.stats();
+  }
+
   get namespace() {
     return this._sess.namespace;
   }
@@ -144,6 +303,18 @@ class Session extends EventEmitter {
     return paperfilter.Session.devices;
   }
 
+  static get nativeDissectors() {
+    if (paperfilter == null) {
+      return [];
+    }
+    return paperfilter.Session.nativeDissectors;
+  }
+
+  static hasNativeDissector(name) {
+    return typeof name === 'string' &&
+      Session.nativeDissectors.includes(name);
+  }
+
   static get tmpDir() {
     if (paperfilter == null) {
      return '';
@@ -208,18 +379,19 @@ class Session extends EventEmitter {
     this._sess.close();
   }
 
-  registerDissector(script) {
-    roll(script).then((code) => {
-      this.unregisterDissector(script);
-      this._option.dissectors.push({
-        script: code,
-        resourceName: script
+  // A dissector may name a native implementation to use instead of the
+  // script when the native module provides one.
+  registerDissector(script, option = {}) {
+    return loadDissector(script, option.native, this._option.bundle_cache)
+      .then((loaded) => {
+        this._removeDissector(script);
+        this._option.dissectors.push(loaded);
+        return this._reloadDissector(script, loaded.script, loaded.native);
       });
-    });
   }
 
   registerStreamDissector(script) {
-    roll(script).then((code) => {
+    roll(script, this._option.bundle_cache).then((code) => {
       this.unregisterStreamDissector(script);
       this._option.stream_dissectors.push({
         script: code,
@@ -229,6 +401,11 @@ class Session extends EventEmitter {
   }
 
   unregisterDissector(script) {
+    this._removeDissector(script);
+    return this._reloadDissector(script, null);
+  }
+
+  _removeDissector(script) {
     let list = [];
     for (let item of this._option.dissectors) {
       if (item.resourceName !== script) {
@@ -236,7 +413,22 @@ class Session extends EventEmitter {
       }
     }
     this._option.dissectors = list;
-    this._reset();
+  }
+
+  // Swaps the dissector in the running threads and re-dissects only the
+  // packets it applies to. If the threads do not load it in time, the
+  // session falls back to a full reset and the promise is rejected.
+  _reloadDissector(script, code, native) {
+    return new Promise((resolve, reject) => {
+      this._sess.reloadDissector(script, code, native, (err) => {
+        if (err == null) {
+          resolve();
+        } else {
+          this._reset();
+          reject(new Error(err));
+        }
+      });
+    });
   }
 
   unregisterStreamDissector(script) {
@@ -1,7 +1,7 @@
 #include "item.hpp"
 #include "item_value.hpp"
+#include "option_keys.hpp"
 #include <v8pp/class.hpp>
-#include <v8pp/object.hpp>
 #include <vector>
 
 using namespace v8;
@@ -16,20 +16,20 @@ public:
   std::unordered_map<std::string, ItemValue> attrs;
 };
 
-Item::Item() : d(new Private()) {}
+Item::Item() : d(std::make_shared<Private>()) {}
 
 Item::Item(const v8::FunctionCallbackInfo<v8::Value> &args) : Item(args[0]) {}
 
-Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
+Item::Item(v8::Local<v8::Value> value) : d(std::make_shared<Private>()) {
   Isolate *isolate = Isolate::GetCurrent();
   if (!value.IsEmpty() && value->IsObject()) {
     v8::Local<v8::Object> obj = value.As<v8::Object>();
-    v8pp::get_option(isolate, obj, "name", d->name);
-    v8pp::get_option(isolate, obj, "id", d->id);
-    v8pp::get_option(isolate, obj, "range", d->range);
+    OptionKeys::getOption(isolate, obj, OptionKeys::NAME, d->name);
+    OptionKeys::getOption(isolate, obj, OptionKeys::ID, d->id);
+    OptionKeys::getOption(isolate, obj, OptionKeys::RANGE, d->range);
 
     v8::Local<v8::Value> value;
-    if (v8pp::get_option(isolate, obj, "value", value)) {
+    if (OptionKeys::getOption(isolate, obj, OptionKeys::VALUE, value)) {
       if (ItemValue *iv =
               v8pp::class_<ItemValue>::unwrap_object(isolate, value)) {
         d->value = *iv;
@@ -39,7 +39,7 @@ Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
     }
 
     v8::Local<v8::Array> items;
-    if (v8pp::get_option(isolate, obj, "items", items)) {
+    if (OptionKeys::getOption(isolate, obj, OptionKeys::ITEMS, items)) {
       for (uint32_t i = 0; i < items->Length(); ++i) {
         v8::Local<v8::Value> item = items->Get(i);
         if (item->IsObject())
@@ -48,7 +48,7 @@ Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
     }
 
     v8::Local<v8::Object> attrs;
-    if (v8pp::get_option(isolate, obj, "attrs", attrs)) {
+    if (OptionKeys::getOption(isolate, obj, OptionKeys::ATTRS, attrs)) {
       v8::Local<v8::Array> keys = attrs->GetPropertyNames();
       for (uint32_t i = 0; i < keys->Length(); ++i) {
         v8::Local<v8::Value> key = keys->Get(i);
@@ -62,21 +62,39 @@ Item::Item(v8::Local<v8::Value> value) : d(new Private()) {
   }
 }
 
-Item::Item(const Item &item) : d(new Private(*item.d)) {}
+Item::Item(const std::string &name, const ItemValue &value,
+           const std::string &range)
+    : d(std::make_shared<Private>()) {
+  d->name = name;
+  d->value = value;
+  d->range = range;
+}
+
+// Copies share their data until one of them is modified.
+Item::Item(const Item &item) : d(item.d) {}
 
 Item::~Item() {}
 
 std::string Item::name() const { return d->name; }
 
-void Item::setName(const std::string &name) { d->name = name; }
+void Item::setName(const std::string &name) {
+  detach();
+  d->name = name;
+}
 
 std::string Item::id() const { return d->id; }
 
-void Item::setId(const std::string &id) { d->id = id; }
+void Item::setId(const std::string &id) {
+  detach();
+  d->id = id;
+}
 
 std::string Item::range() const { return d->range; }
 
-void Item::setRange(const std::string &range) { d->range = range; }
+void Item::setRange(const std::string &range) {
+  detach();
+  d->range = range;
+}
 
 v8::Local<v8::Object> Item::valueObject() const {
   Isolate *isolate = Isolate::GetCurrent();
@@ -89,6 +107,7 @@ ItemValue Item::value() const { return d->value; }
 void Item::setValue(v8::Local<v8::Object> value) {
   Isolate *isolate = Isolate::GetCurrent();
   if (ItemValue *iv = v8pp::class_<ItemValue>::unwrap_object(isolate, value)) {
+    detach();
     d->value = *iv;
   }
 }
@@ -97,6 +116,7 @@ std::vector<Item> Item::items() const { return d->items; }
 
 void Item::addItem(v8::Local<v8::Object> obj) {
   Isolate *isolate = Isolate::GetCurrent();
+  detach();
   if (Item *item = v8pp::class_<Item>::unwrap_object(isolate, obj)) {
     d->items.emplace_back(*item);
   } else if (obj->IsObject()) {
@@ -104,8 +124,14 @@ void Item::addItem(v8::Local<v8::Object> obj) {
   }
 }
 
+void Item::addItem(const Item &item) {
+  detach();
+  d->items.push_back(item);
+}
+
 void Item::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   Isolate *isolate = Isolate::GetCurrent();
+  detach();
   if (ItemValue *item = v8pp::class_<ItemValue>::unwrap_object(isolate, obj)) {
     d->attrs.emplace(name, *item);
   } else {
@@ -113,6 +139,17 @@ void Item::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   }
 }
 
+void Item::setAttr(const std::string &name, const ItemValue &value) {
+  detach();
+  d->attrs.emplace(name, value);
+}
+
 std::unordered_map<std::string, ItemValue> Item::attrs() const {
   return d->attrs;
 }
+
+void Item::detach() {
+  if (d.use_count() > 1) {
+    d = std::make_shared<Private>(*d);
+  }
+}
@@ -13,6 +13,8 @@ public:
   Item();
   Item(const v8::FunctionCallbackInfo<v8::Value> &args);
   Item(v8::Local<v8::Value> value);
+  Item(const std::string &name, const ItemValue &value,
+       const std::string &range);
   Item(const Item &item);
   ~Item();
 
@@ -28,13 +30,18 @@ public:
 
   std::vector<Item> items() const;
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const Item &item);
 
   void setAttr(const std::string &name, v8::Local<v8::Value> obj);
+  void setAttr(const std::string &name, const ItemValue &value);
   std::unordered_map<std::string, ItemValue> attrs() const;
 
+private:
+  void detach();
+
 private:
   class Private;
-  std::unique_ptr<Private> d;
+  std::shared_ptr<Private> d;
 };
 
 #endif
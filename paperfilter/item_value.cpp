@@ -1,13 +1,24 @@
 #include "item_value.hpp"
+#include "address.hpp"
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "session_large_buffer_wrapper.hpp"
+#include <json11.hpp>
 #include <memory>
+#include <mutex>
 #include <nan.h>
 #include <node_buffer.h>
 #include <v8pp/class.hpp>
 #include <v8pp/json.hpp>
 
+namespace {
+bool isAddressType(const std::string &type, size_t size) {
+  return (type == "dripcap/ipv4/addr" && size == 4) ||
+         (type == "dripcap/ipv6/addr" && size == 16) ||
+         (type == "dripcap/mac" && size == 6);
+}
+}
+
 class ItemValue::Private {
 public:
   BaseType base = NUL;
@@ -16,14 +27,22 @@ public:
   std::unique_ptr<Buffer> buf;
   std::unique_ptr<LargeBuffer> lbuf;
   std::string type;
+  std::once_flag jsonOnce;
+  std::shared_ptr<const json11::Json> json;
 };
 
-ItemValue::ItemValue() : d(new Private()) {}
+ItemValue::ItemValue() : d(std::make_shared<Private>()) {}
 
 ItemValue::ItemValue(const v8::FunctionCallbackInfo<v8::Value> &args)
     : ItemValue(args[0]) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
   d->type = v8pp::from_v8<std::string>(isolate, args[1], "");
+  // Addresses keep their raw bytes and are only formatted when read.
+  if (d->base == BUFFER && isAddressType(d->type, d->buf->length())) {
+    d->str.assign(d->buf->data(), d->buf->length());
+    d->buf.reset();
+    d->base = ADDRESS;
+  }
 }
 
 ItemValue::ItemValue(const v8::Local<v8::Value> &val) : ItemValue() {
@@ -55,21 +74,42 @@ ItemValue::ItemValue(const v8::Local<v8::Value> &val) : ItemValue() {
   }
 }
 
-ItemValue::ItemValue(const ItemValue &value) : ItemValue() { *this = value; }
+ItemValue::ItemValue(double num) : ItemValue() {
+  d->num = num;
+  d->base = NUMBER;
+}
 
-ItemValue &ItemValue::operator=(const ItemValue &other) {
-  if (&other == this)
-    return *this;
-  d->base = other.d->base;
-  d->num = other.d->num;
-  d->str = other.d->str;
-  if (other.d->buf) {
-    d->buf = other.d->buf->slice();
+ItemValue::ItemValue(bool value) : ItemValue() {
+  d->num = value;
+  d->base = BOOLEAN;
+}
+
+ItemValue::ItemValue(BaseType base, const std::string &str,
+                     const std::string &type)
+    : ItemValue() {
+  d->str = str;
+  d->base = base;
+  d->type = type;
+}
+
+ItemValue::ItemValue(std::unique_ptr<Buffer> buffer, const std::string &type)
+    : ItemValue() {
+  d->type = type;
+  if (isAddressType(type, buffer->length())) {
+    d->str.assign(buffer->data(), buffer->length());
+    d->base = ADDRESS;
+  } else {
+    d->buf = std::move(buffer);
     d->buf->freeze();
-  } else if (other.d->lbuf) {
-    d->lbuf.reset(new LargeBuffer(*other.d->lbuf));
+    d->base = BUFFER;
   }
-  d->type = other.d->type;
+}
+
+// Values are never modified after construction, so copies share them.
+ItemValue::ItemValue(const ItemValue &value) : d(value.d) {}
+
+ItemValue &ItemValue::operator=(const ItemValue &other) {
+  d = other.d;
   return *this;
 }
 
@@ -115,9 +155,31 @@ v8::Local<v8::Value> ItemValue::data() const {
   case JSON:
     val = v8pp::json_parse(isolate, d->str);
     break;
+  case ADDRESS:
+    val = v8pp::to_v8(isolate, Address::format(d->str.data(), d->str.size()));
+    break;
   default:;
   }
   return val;
 }
 
 std::string ItemValue::type() const { return d->type; }
+
+ItemValue::BaseType ItemValue::base() const { return d->base; }
+
+double ItemValue::number() const { return d->num; }
+
+const std::string &ItemValue::string() const { return d->str; }
+
+const std::string &ItemValue::address() const { return d->str; }
+
+const Buffer *ItemValue::buffer() const { return d->buf.get(); }
+
+std::shared_ptr<const json11::Json> ItemValue::json() const {
+  std::call_once(d->jsonOnce, [this]() {
+    std::string err;
+    d->json = std::make_shared<const json11::Json>(
+        json11::Json::parse(d->base == JSON ? d->str : "null", err));
+  });
+  return d->json;
+}
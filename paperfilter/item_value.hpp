@@ -6,24 +6,50 @@
 #include <v8.h>
 
 class Buffer;
+namespace json11 {
+class Json;
+}
 
 class ItemValue {
 public:
-  enum BaseType { NUL, NUMBER, BOOLEAN, STRING, BUFFER, LARGE_BUFFER, JSON };
+  enum BaseType {
+    NUL,
+    NUMBER,
+    BOOLEAN,
+    STRING,
+    BUFFER,
+    LARGE_BUFFER,
+    JSON,
+    ADDRESS
+  };
 
 public:
   ItemValue();
   explicit ItemValue(const v8::FunctionCallbackInfo<v8::Value> &args);
   explicit ItemValue(const v8::Local<v8::Value> &val);
+  explicit ItemValue(double num);
+  explicit ItemValue(bool value);
+  ItemValue(BaseType base, const std::string &str,
+            const std::string &type = std::string());
+  ItemValue(std::unique_ptr<Buffer> buffer,
+            const std::string &type = std::string());
   ItemValue(const ItemValue &value);
   ItemValue &operator=(const ItemValue &);
   ~ItemValue();
   v8::Local<v8::Value> data() const;
   std::string type() const;
 
+  BaseType base() const;
+  double number() const;
+  const std::string &string() const;
+  const std::string &address() const;
+  const Buffer *buffer() const;
+  // Parsed on first use and shared by every copy.
+  std::shared_ptr<const json11::Json> json() const;
+
 private:
   class Private;
-  std::unique_ptr<Private> d;
+  std::shared_ptr<Private> d;
 };
 
 #endif
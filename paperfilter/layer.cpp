@@ -2,8 +2,9 @@
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "item.hpp"
+#include "option_keys.hpp"
+#include "layer_id.hpp"
 #include <v8pp/class.hpp>
-#include <v8pp/object.hpp>
 
 using namespace v8;
 
@@ -12,6 +13,7 @@ public:
   std::string ns;
   std::string name;
   std::string id;
+  uint32_t internedId = 0;
   std::string summary;
   std::string range;
   std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
@@ -28,14 +30,15 @@ Layer::Layer(const std::string &ns) : d(std::make_shared<Private>()) {
 
 Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  v8pp::get_option(isolate, options, "namespace", d->ns);
-  v8pp::get_option(isolate, options, "name", d->name);
-  v8pp::get_option(isolate, options, "id", d->id);
-  v8pp::get_option(isolate, options, "summary", d->summary);
-  v8pp::get_option(isolate, options, "range", d->range);
+  OptionKeys::getOption(isolate, options, OptionKeys::NAMESPACE, d->ns);
+  OptionKeys::getOption(isolate, options, OptionKeys::NAME, d->name);
+  OptionKeys::getOption(isolate, options, OptionKeys::ID, d->id);
+  d->internedId = LayerId::intern(d->id);
+  OptionKeys::getOption(isolate, options, OptionKeys::SUMMARY, d->summary);
+  OptionKeys::getOption(isolate, options, OptionKeys::RANGE, d->range);
 
   v8::Local<v8::Array> items;
-  if (v8pp::get_option(isolate, options, "items", items)) {
+  if (OptionKeys::getOption(isolate, options, OptionKeys::ITEMS, items)) {
     for (uint32_t i = 0; i < items->Length(); ++i) {
       v8::Local<v8::Value> item = items->Get(i);
       if (item->IsObject())
@@ -44,7 +47,7 @@ Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
   }
 
   v8::Local<v8::Object> attrs;
-  if (v8pp::get_option(isolate, options, "attrs", attrs)) {
+  if (OptionKeys::getOption(isolate, options, OptionKeys::ATTRS, attrs)) {
     v8::Local<v8::Array> keys = attrs->GetPropertyNames();
     for (uint32_t i = 0; i < keys->Length(); ++i) {
       v8::Local<v8::Value> key = keys->Get(i);
@@ -56,7 +59,7 @@ Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
   }
 
   v8::Local<v8::Object> payload;
-  if (v8pp::get_option(isolate, options, "payload", payload)) {
+  if (OptionKeys::getOption(isolate, options, OptionKeys::PAYLOAD, payload)) {
     if (Buffer *buffer =
             v8pp::class_<Buffer>::unwrap_object(isolate, payload)) {
       d->payload = buffer->slice();
@@ -71,6 +74,25 @@ Layer::Layer(v8::Local<v8::Object> options) : d(std::make_shared<Private>()) {
 
 Layer::~Layer() {}
 
+std::shared_ptr<Layer> Layer::clone() const {
+  auto layer = std::make_shared<Layer>(d->ns);
+  Private &p = *layer->d;
+  p.name = d->name;
+  p.id = d->id;
+  p.internedId = d->internedId;
+  p.summary = d->summary;
+  p.range = d->range;
+  p.items = std::vector<Item>(d->items);
+  p.attrs = std::unordered_map<std::string, ItemValue>(d->attrs);
+  if (d->payload) {
+    p.payload = d->payload->slice();
+  }
+  if (d->largePayload) {
+    p.largePayload.reset(new LargeBuffer(*d->largePayload));
+  }
+  return layer;
+}
+
 std::string Layer::ns() const { return d->ns; }
 
 void Layer::setNs(const std::string &ns) { d->ns = ns; }
@@ -81,7 +103,12 @@ void Layer::setName(const std::string &name) { d->name = name; }
 
 std::string Layer::id() const { return d->id; }
 
-void Layer::setId(const std::string &id) { d->id = id; }
+void Layer::setId(const std::string &id) {
+  d->id = id;
+  d->internedId = LayerId::intern(id);
+}
+
+uint32_t Layer::internedId() const { return d->internedId; }
 
 std::string Layer::summary() const { return d->summary; };
 
@@ -123,6 +150,8 @@ void Layer::addItem(v8::Local<v8::Object> obj) {
   }
 }
 
+void Layer::addItem(const Item &item) { d->items.push_back(item); }
+
 std::vector<Item> Layer::items() const { return d->items; }
 
 std::unique_ptr<Buffer> Layer::payload() const {
@@ -179,6 +208,10 @@ void Layer::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   }
 }
 
-std::unordered_map<std::string, ItemValue> Layer::attrs() const {
+void Layer::setAttr(const std::string &name, const ItemValue &value) {
+  d->attrs.emplace(name, value);
+}
+
+const std::unordered_map<std::string, ItemValue> &Layer::attrs() const {
   return d->attrs;
 }
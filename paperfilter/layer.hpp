@@ -20,12 +20,15 @@ public:
   ~Layer();
   Layer &operator=(const Layer &) = delete;
 
+  std::shared_ptr<Layer> clone() const;
+
   std::string ns() const;
   void setNs(const std::string &ns);
   std::string name() const;
   void setName(const std::string &name);
   std::string id() const;
   void setId(const std::string &name);
+  uint32_t internedId() const;
   std::string summary() const;
   void setSummary(const std::string &summary);
   std::string range() const;
@@ -39,6 +42,7 @@ public:
   std::shared_ptr<Packet> packet() const;
 
   void addItem(v8::Local<v8::Object> obj);
+  void addItem(const Item &item);
   std::vector<Item> items() const;
 
   std::unique_ptr<Buffer> payload() const;
@@ -48,7 +52,8 @@ public:
   v8::Local<v8::Object> payloadBuffer() const;
 
   void setAttr(const std::string &name, v8::Local<v8::Value> obj);
-  std::unordered_map<std::string, ItemValue> attrs() const;
+  void setAttr(const std::string &name, const ItemValue &value);
+  const std::unordered_map<std::string, ItemValue> &attrs() const;
 
 private:
   class Private;
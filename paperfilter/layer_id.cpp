@@ -0,0 +1,33 @@
+#include "layer_id.hpp"
+#include <unordered_map>
+#include <uv.h>
+
+namespace {
+class Table {
+public:
+  Table() { uv_rwlock_init(&rwlock); }
+  ~Table() { uv_rwlock_destroy(&rwlock); }
+
+public:
+  uv_rwlock_t rwlock;
+  std::unordered_map<std::string, uint32_t> ids;
+};
+}
+
+uint32_t LayerId::intern(const std::string &id) {
+  if (id.empty())
+    return 0;
+
+  static Table table;
+  uv_rwlock_rdlock(&table.rwlock);
+  auto it = table.ids.find(id);
+  uint32_t value = (it != table.ids.end()) ? it->second : 0;
+  uv_rwlock_rdunlock(&table.rwlock);
+  if (value)
+    return value;
+
+  uv_rwlock_wrlock(&table.rwlock);
+  value = table.ids.emplace(id, table.ids.size() + 1).first->second;
+  uv_rwlock_wrunlock(&table.rwlock);
+  return value;
+}
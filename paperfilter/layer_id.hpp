@@ -0,0 +1,13 @@
+#ifndef LAYER_ID_HPP
+#define LAYER_ID_HPP
+
+#include <cstdint>
+#include <string>
+
+class LayerId {
+public:
+  static uint32_t intern(const std::string &id);
+  static uint64_t bit(uint32_t id) { return id ? 1ull << (id & 63) : 0; }
+};
+
+#endif
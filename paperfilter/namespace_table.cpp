@@ -0,0 +1,133 @@
+#include "namespace_table.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+const size_t memoSize = 4096;
+const size_t maxProbes = 32;
+
+struct Pattern {
+  std::string prefix;
+  std::regex regex;
+  uint32_t index;
+};
+
+struct Entry {
+  std::string ns;
+  std::vector<uint32_t> indices;
+};
+
+// The literal text every match of |source| must start with.
+std::string literalPrefix(const std::string &source) {
+  if (source.find('|') != std::string::npos)
+    return std::string();
+  size_t start = (!source.empty() && source[0] == '^') ? 1 : 0;
+  std::string prefix;
+  for (size_t i = start; i < source.size(); ++i) {
+    char c = source[i];
+    if (std::strchr("\\^$.|?*+()[]{}", c))
+      break;
+    if (i + 1 < source.size() && std::strchr("?*{", source[i + 1]))
+      break;
+    prefix += c;
+  }
+  return prefix;
+}
+}
+
+class NamespaceTable::Private {
+public:
+  Private();
+  ~Private();
+  std::vector<uint32_t> match(const std::string &ns) const;
+
+public:
+  std::vector<std::string> names;
+  std::unordered_map<std::string, std::vector<uint32_t>> exact;
+  std::vector<Pattern> patterns;
+
+  std::unique_ptr<std::atomic<Entry *>[]> memo;
+  std::mutex overflowMutex;
+  std::unordered_map<std::string, std::unique_ptr<Entry>> overflow;
+};
+
+NamespaceTable::Private::Private() : memo(new std::atomic<Entry *>[memoSize]) {
+  for (size_t i = 0; i < memoSize; ++i) {
+    memo[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+NamespaceTable::Private::~Private() {
+  for (size_t i = 0; i < memoSize; ++i) {
+    delete memo[i].load(std::memory_order_relaxed);
+  }
+}
+
+std::vector<uint32_t>
+NamespaceTable::Private::match(const std::string &ns) const {
+  std::vector<uint32_t> indices;
+  const auto it = exact.find(ns);
+  if (it != exact.end()) {
+    indices = it->second;
+  }
+  for (const Pattern &pattern : patterns) {
+    if (ns.compare(0, pattern.prefix.size(), pattern.prefix) == 0 &&
+        std::regex_match(ns, pattern.regex)) {
+      indices.push_back(pattern.index);
+    }
+  }
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+  return indices;
+}
+
+NamespaceTable::NamespaceTable(
+    const std::vector<std::pair<std::string, DissectorNamespaces>>
+        &dissectors)
+    : d(new Private()) {
+  for (uint32_t index = 0; index < dissectors.size(); ++index) {
+    const DissectorNamespaces &namespaces = dissectors[index].second;
+    d->names.push_back(dissectors[index].first);
+    for (const std::string &ns : namespaces.namespaces) {
+      d->exact[ns].push_back(index);
+    }
+    for (size_t i = 0; i < namespaces.regexNamespaces.size(); ++i) {
+      d->patterns.push_back({literalPrefix(namespaces.regexSources[i]),
+                             namespaces.regexNamespaces[i], index});
+    }
+  }
+}
+
+NamespaceTable::~NamespaceTable() {}
+
+const std::vector<std::string> &NamespaceTable::names() const {
+  return d->names;
+}
+
+const std::vector<uint32_t> &
+NamespaceTable::find(const std::string &ns) const {
+  size_t slot = std::hash<std::string>()(ns) % memoSize;
+  for (size_t i = 0; i < maxProbes; ++i, slot = (slot + 1) % memoSize) {
+    Entry *entry = d->memo[slot].load(std::memory_order_acquire);
+    if (!entry) {
+      std::unique_ptr<Entry> created(new Entry{ns, d->match(ns)});
+      if (d->memo[slot].compare_exchange_strong(entry, created.get(),
+                                                std::memory_order_acq_rel)) {
+        return created.release()->indices;
+      }
+    }
+    if (entry->ns == ns)
+      return entry->indices;
+  }
+
+  // Only reached once the memo is crowded; fall back to a locked map.
+  std::lock_guard<std::mutex> lock(d->overflowMutex);
+  std::unique_ptr<Entry> &entry = d->overflow[ns];
+  if (!entry) {
+    entry.reset(new Entry{ns, d->match(ns)});
+  }
+  return entry->indices;
+}
@@ -0,0 +1,31 @@
+#ifndef NAMESPACE_TABLE_HPP
+#define NAMESPACE_TABLE_HPP
+
+#include "dissector.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Maps layer namespaces to the dissectors that handle them. Built once per
+// dissector set and shared read-only by all threads; lookups are memoized
+// without locking.
+class NamespaceTable {
+public:
+  explicit NamespaceTable(
+      const std::vector<std::pair<std::string, DissectorNamespaces>>
+          &dissectors);
+  ~NamespaceTable();
+  NamespaceTable(const NamespaceTable &) = delete;
+  NamespaceTable &operator=(const NamespaceTable &) = delete;
+
+  const std::vector<std::string> &names() const;
+  const std::vector<uint32_t> &find(const std::string &ns) const;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
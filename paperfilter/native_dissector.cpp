@@ -0,0 +1,51 @@
+#include "native_dissector.hpp"
+#include "builtin_dissectors.hpp"
+#include "table_dissector.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+std::mutex mutex;
+std::unordered_map<std::string, NativeDissector::Factory> &factories() {
+  static std::unordered_map<std::string, NativeDissector::Factory> map;
+  static std::once_flag builtins;
+  std::call_once(builtins, [] {
+    BuiltinDissectors::registerAll(&map);
+    map["table"] = [](const std::string &source) {
+      return std::unique_ptr<NativeDissector>(new TableDissector(source));
+    };
+  });
+  return map;
+}
+}
+
+NativeDissector::~NativeDissector() {}
+
+void NativeDissector::registerDissector(const std::string &name,
+                                        const Factory &factory) {
+  std::lock_guard<std::mutex> lock(mutex);
+  factories()[name] = factory;
+}
+
+std::unique_ptr<NativeDissector>
+NativeDissector::create(const std::string &name, const std::string &source) {
+  Factory factory;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto &map = factories();
+    const auto it = map.find(name);
+    if (it == map.end())
+      return nullptr;
+    factory = it->second;
+  }
+  return factory(source);
+}
+
+std::vector<std::string> NativeDissector::names() {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::vector<std::string> list;
+  for (const auto &pair : factories()) {
+    list.push_back(pair.first);
+  }
+  return list;
+}
@@ -0,0 +1,46 @@
+#ifndef NATIVE_DISSECTOR_HPP
+#define NATIVE_DISSECTOR_HPP
+
+#include "dissector.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class Layer;
+class Packet;
+class StreamChunk;
+
+// A dissector implemented in C++. Instances are created by name on each
+// dissector thread and called without entering V8, so they must build
+// the same layers, items and attrs as the script they replace.
+//
+// Factories receive the registered script source; compiled dissectors
+// such as "table" parse it and throw std::invalid_argument if it is
+// malformed, while builtins ignore it.
+class NativeDissector {
+public:
+  typedef std::function<std::unique_ptr<NativeDissector>(
+      const std::string &source)>
+      Factory;
+
+public:
+  virtual ~NativeDissector();
+  virtual DissectorNamespaces namespaces() const = 0;
+
+  // Throws std::exception on malformed input; the error is logged like an
+  // exception thrown by a script.
+  virtual void analyze(const Packet &packet, const Layer &parentLayer,
+                       std::vector<std::shared_ptr<Layer>> *layers,
+                       std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const = 0;
+
+public:
+  static void registerDissector(const std::string &name,
+                                const Factory &factory);
+  static std::unique_ptr<NativeDissector>
+  create(const std::string &name, const std::string &source = std::string());
+  static std::vector<std::string> names();
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "native_values.hpp"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "layer.hpp"
+#include <algorithm>
+#include <json11.hpp>
+#include <stdexcept>
+
+namespace NativeValues {
+
+const char outOfRange[] = "index out of range";
+
+namespace {
+std::string jsonKey(const std::string &name) {
+  return json11::Json(name).dump() + ":";
+}
+}
+
+uint8_t readUInt8(const Buffer &buf, size_t offset) {
+  if (offset + 1 > buf.length())
+    throw std::out_of_range(outOfRange);
+  return static_cast<uint8_t>(*buf.data(offset));
+}
+
+uint16_t readUInt16BE(const Buffer &buf, size_t offset) {
+  if (offset + 2 > buf.length())
+    throw std::out_of_range(outOfRange);
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf.data(offset));
+  return (p[0] << 8) | p[1];
+}
+
+uint32_t readUInt32BE(const Buffer &buf, size_t offset) {
+  if (offset + 4 > buf.length())
+    throw std::out_of_range(outOfRange);
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(buf.data(offset));
+  return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) |
+         p[3];
+}
+
+std::unique_ptr<Buffer> slice(const Buffer &buf, size_t start, size_t end) {
+  start = std::min(start, buf.length());
+  end = std::min(end, buf.length());
+  return buf.slice(start, std::max(start, end));
+}
+
+std::unique_ptr<Buffer> slice(const Buffer &buf, size_t start) {
+  return slice(buf, start, buf.length());
+}
+
+std::unique_ptr<Buffer> payloadOf(const Layer &layer) {
+  std::unique_ptr<Buffer> payload = layer.payload();
+  if (!payload)
+    throw std::invalid_argument("parent layer has no payload");
+  return payload;
+}
+
+std::string range(size_t start, size_t end) {
+  return std::to_string(start) + ":" + std::to_string(end);
+}
+
+std::string range(size_t start) { return std::to_string(start) + ":"; }
+
+ItemValue number(double num) { return ItemValue(num); }
+
+ItemValue text(const std::string &str, const std::string &type) {
+  return ItemValue(ItemValue::STRING, str, type);
+}
+
+ItemValue enumValue(const EnumTable &table, uint32_t value) {
+  const auto it = table.find(value);
+  const std::string name = (it != table.end()) ? it->second : "Unknown";
+  return ItemValue(ItemValue::JSON, "{" + jsonKey(name) + "true," +
+                                        jsonKey("_value") +
+                                        std::to_string(value) + "}",
+                   "dripcap/enum");
+}
+
+ItemValue flagsValue(const FlagTable &table, uint32_t value) {
+  std::string json = "{";
+  for (const auto &pair : table) {
+    json += jsonKey(pair.first) + ((pair.second & value) ? "true," : "false,");
+  }
+  json += jsonKey("_value") + std::to_string(value) + "}";
+  return ItemValue(ItemValue::JSON, json, "dripcap/flags");
+}
+
+const std::string *enumName(const EnumTable &table, uint32_t value) {
+  const auto it = table.find(value);
+  return (it != table.end()) ? &it->second : nullptr;
+}
+
+const ItemValue *attr(const Layer &layer, const std::string &name) {
+  const auto &attrs = layer.attrs();
+  const auto it = attrs.find(name);
+  return (it != attrs.end()) ? &it->second : nullptr;
+}
+
+std::string replaceFirst(std::string str, const std::string &from,
+                         const std::string &to) {
+  const size_t pos = str.find(from);
+  if (pos != std::string::npos)
+    str.replace(pos, from.size(), to);
+  return str;
+}
+
+std::string formatAddress(const ItemValue &value) {
+  if (value.base() != ItemValue::ADDRESS)
+    throw std::invalid_argument("Invalid address");
+  return Address::format(value.address().data(), value.address().size());
+}
+}
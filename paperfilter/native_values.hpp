@@ -0,0 +1,55 @@
+#ifndef NATIVE_VALUES_HPP
+#define NATIVE_VALUES_HPP
+
+#include "item_value.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class Buffer;
+class Layer;
+
+// Helpers shared by native dissectors. Reads throw std::out_of_range past
+// the end of the buffer, like unpack() in scripts.
+namespace NativeValues {
+typedef std::unordered_map<uint32_t, std::string> EnumTable;
+typedef std::vector<std::pair<std::string, uint32_t>> FlagTable;
+
+extern const char outOfRange[];
+
+uint8_t readUInt8(const Buffer &buf, size_t offset);
+uint16_t readUInt16BE(const Buffer &buf, size_t offset);
+uint32_t readUInt32BE(const Buffer &buf, size_t offset);
+
+// Clamps like Buffer#slice in scripts, without letting end precede start.
+std::unique_ptr<Buffer> slice(const Buffer &buf, size_t start, size_t end);
+std::unique_ptr<Buffer> slice(const Buffer &buf, size_t start);
+
+// Throws std::invalid_argument if |layer| has no payload.
+std::unique_ptr<Buffer> payloadOf(const Layer &layer);
+
+std::string range(size_t start, size_t end);
+std::string range(size_t start);
+
+ItemValue number(double num);
+ItemValue text(const std::string &str,
+               const std::string &type = std::string());
+
+// Same JSON as Enum() and Flags() in dripcap/utils.
+ItemValue enumValue(const EnumTable &table, uint32_t value);
+ItemValue flagsValue(const FlagTable &table, uint32_t value);
+
+const std::string *enumName(const EnumTable &table, uint32_t value);
+const ItemValue *attr(const Layer &layer, const std::string &name);
+
+std::string replaceFirst(std::string str, const std::string &from,
+                        const std::string &to);
+
+// Throws std::invalid_argument unless |value| is an address.
+std::string formatAddress(const ItemValue &value);
+}
+
+#endif
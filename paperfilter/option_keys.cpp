@@ -0,0 +1,28 @@
+#include "option_keys.hpp"
+#include <vector>
+
+namespace {
+const char *const names[] = {"namespace", "name",  "id",      "summary",
+                             "range",     "items", "attrs",   "payload",
+                             "value",     "layer"};
+
+// Each dissector thread owns exactly one isolate for its whole lifetime.
+struct Cache {
+  v8::Isolate *isolate = nullptr;
+  std::vector<v8::Eternal<v8::String>> keys;
+};
+thread_local Cache cache;
+}
+
+v8::Local<v8::String> OptionKeys::key(v8::Isolate *isolate, Key key) {
+  if (cache.isolate != isolate) {
+    cache.isolate = isolate;
+    cache.keys.clear();
+    for (const char *name : names) {
+      cache.keys.emplace_back(
+          isolate, v8::String::NewFromUtf8(isolate, name,
+                                           v8::String::kInternalizedString));
+    }
+  }
+  return cache.keys[key].Get(isolate);
+}
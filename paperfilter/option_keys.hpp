@@ -0,0 +1,38 @@
+#ifndef OPTION_KEYS_HPP
+#define OPTION_KEYS_HPP
+
+#include <v8.h>
+#include <v8pp/convert.hpp>
+
+// Property names read from dissector output. They are internalized once per
+// isolate, so lookups skip creating and hashing a new string every time a
+// layer or item is converted.
+namespace OptionKeys {
+enum Key {
+  NAMESPACE,
+  NAME,
+  ID,
+  SUMMARY,
+  RANGE,
+  ITEMS,
+  ATTRS,
+  PAYLOAD,
+  VALUE,
+  LAYER
+};
+
+v8::Local<v8::String> key(v8::Isolate *isolate, Key key);
+
+// Same as v8pp::get_option() with a cached key.
+template <class T>
+bool getOption(v8::Isolate *isolate, v8::Local<v8::Object> options, Key name,
+               T &value) {
+  v8::Local<v8::Value> val = options->Get(key(isolate, name));
+  if (val.IsEmpty() || val->IsUndefined())
+    return false;
+  value = v8pp::from_v8<T>(isolate, val);
+  return true;
+}
+}
+
+#endif
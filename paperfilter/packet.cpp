@@ -2,7 +2,9 @@
 #include "buffer.hpp"
 #include "large_buffer.hpp"
 #include "layer.hpp"
+#include "layer_id.hpp"
 #include "session_item_value_wrapper.hpp"
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <node_buffer.h>
@@ -24,6 +26,50 @@ std::shared_ptr<Layer> leafLayer(
   }
 }
 
+void indexLayers(
+    const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers,
+    std::vector<std::pair<uint32_t, const Layer *>> *index, uint64_t *mask) {
+  for (const auto &pair : layers) {
+    uint32_t id = pair.second->internedId();
+    if (!id)
+      continue;
+    bool indexed = std::any_of(
+        index->begin(), index->end(),
+        [id](const std::pair<uint32_t, const Layer *> &p) {
+          return p.first == id;
+        });
+    if (!indexed) {
+      index->emplace_back(id, pair.second.get());
+      *mask |= LayerId::bit(id);
+    }
+  }
+  for (const auto &pair : layers) {
+    indexLayers(pair.second->layers(), index, mask);
+  }
+}
+
+// Copies the layer tree, cutting it at the first affected layer on each
+// branch. Returns false if no layer was affected.
+bool cloneLayers(
+    const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers,
+    std::unordered_map<std::string, std::shared_ptr<Layer>> *clones,
+    const std::function<bool(const std::string &)> &affected,
+    std::vector<std::shared_ptr<Layer>> *pending) {
+  bool found = false;
+  for (const auto &pair : layers) {
+    const std::shared_ptr<Layer> &layer = pair.second->clone();
+    (*clones)[pair.first] = layer;
+    if (affected(pair.first)) {
+      pending->push_back(layer);
+      found = true;
+    } else if (cloneLayers(pair.second->layers(), &layer->layers(), affected,
+                           pending)) {
+      found = true;
+    }
+  }
+  return found;
+}
+
 void getAttrs(
     const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers,
     std::unordered_map<std::string, ItemValue> *values) {
@@ -59,6 +105,9 @@ public:
   std::unique_ptr<Buffer> payload;
   std::unique_ptr<LargeBuffer> largePayload;
   std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  std::vector<std::pair<uint32_t, const Layer *>> layerIndex;
+  uint64_t layerMask = 0;
+  std::vector<std::shared_ptr<Layer>> pendingLayers;
 };
 
 Packet::Private::Private() {}
@@ -209,6 +258,29 @@ v8::Local<v8::Object> Packet::layersObject() const {
   return obj;
 }
 
+void Packet::buildLayerIndex() {
+  d->layerIndex.clear();
+  d->layerMask = 0;
+  indexLayers(d->layers, &d->layerIndex, &d->layerMask);
+}
+
+const Layer *Packet::layerById(uint32_t id) const {
+  if (!(d->layerMask & LayerId::bit(id)))
+    return nullptr;
+  for (const auto &pair : d->layerIndex) {
+    if (pair.first == id)
+      return pair.second;
+  }
+  return nullptr;
+}
+
+const std::vector<std::pair<uint32_t, const Layer *>> &
+Packet::indexedLayers() const {
+  return d->layerIndex;
+}
+
+uint64_t Packet::layerMask() const { return d->layerMask; }
+
 std::unique_ptr<Packet> Packet::shallowClone() {
   std::unique_ptr<Packet> pkt(new Packet());
   pkt->d->seq = d->seq;
@@ -225,3 +297,21 @@ std::unique_ptr<Packet> Packet::shallowClone() {
   }
   return pkt;
 }
+
+std::unique_ptr<Packet> Packet::partialClone(
+    const std::function<bool(const std::string &)> &affected) {
+  std::unordered_map<std::string, std::shared_ptr<Layer>> layers;
+  std::vector<std::shared_ptr<Layer>> pending;
+  if (!cloneLayers(d->layers, &layers, affected, &pending))
+    return nullptr;
+  std::unique_ptr<Packet> pkt = shallowClone();
+  pkt->d->layers.swap(layers);
+  pkt->d->pendingLayers.swap(pending);
+  return pkt;
+}
+
+std::vector<std::shared_ptr<Layer>> Packet::takePendingLayers() {
+  std::vector<std::shared_ptr<Layer>> layers;
+  layers.swap(d->pendingLayers);
+  return layers;
+}
@@ -1,6 +1,7 @@
 #ifndef PACKET_HPP
 #define PACKET_HPP
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -43,7 +44,15 @@ public:
   const std::unordered_map<std::string, std::shared_ptr<Layer>> &layers() const;
   v8::Local<v8::Object> layersObject() const;
 
+  void buildLayerIndex();
+  const Layer *layerById(uint32_t id) const;
+  const std::vector<std::pair<uint32_t, const Layer *>> &indexedLayers() const;
+  uint64_t layerMask() const;
+
   std::unique_ptr<Packet> shallowClone();
+  std::unique_ptr<Packet>
+  partialClone(const std::function<bool(const std::string &)> &affected);
+  std::vector<std::shared_ptr<Layer>> takePendingLayers();
 
 private:
   Packet();
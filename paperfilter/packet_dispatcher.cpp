@@ -2,43 +2,194 @@
 #include "stream_chunk.hpp"
 #include "dissector_thread.hpp"
 #include "packet.hpp"
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 #include <unordered_map>
 
 class PacketDispatcher::Private {
 public:
   Private(const std::shared_ptr<Context> &ctx);
+  bool overflowing();
 
 public:
   std::shared_ptr<DissectorSharedContext> dissCtx;
   std::vector<std::unique_ptr<DissectorThread>> dissectorThreads;
-  uint32_t packetSeq = 0;
+  std::atomic<uint32_t> packetSeq;
+  size_t maxPackets;
+  size_t maxBytes;
+  OverflowPolicy policy;
+  std::atomic<bool> overloaded;
+  std::atomic<uint64_t> dropped;
+  std::atomic<uint64_t> rawOnly;
 };
 
 PacketDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
-    : dissCtx(std::make_shared<DissectorSharedContext>()) {
+    : dissCtx(std::make_shared<DissectorSharedContext>()), packetSeq(0),
+      maxPackets(ctx->maxQueuedPackets), maxBytes(ctx->maxQueuedBytes),
+      policy(ctx->overflowPolicy), overloaded(false), dropped(0),
+      rawOnly(0) {
 
   dissCtx->dissectors = ctx->dissectors;
   dissCtx->packetCb = ctx->packetCb;
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
+  dissCtx->watchdog =
+      ctx->watchdog ? ctx->watchdog : std::make_shared<Watchdog>(0);
+  dissCtx->maxTimeouts = ctx->maxTimeouts;
   for (int i = 0; i < ctx->threads; ++i) {
-    dissectorThreads.emplace_back(new DissectorThread(dissCtx));
+    dissCtx->queues.emplace_back(new PacketQueue());
+  }
+  dissCtx->counters.resize(ctx->threads);
+  for (int i = 0; i < ctx->threads; ++i) {
+    dissectorThreads.emplace_back(new DissectorThread(dissCtx, i));
   }
 }
 
+// Enters the overloaded state at the high-water mark and leaves it once the
+// queues are down to half, so the policy does not flap on every packet.
+bool PacketDispatcher::Private::overflowing() {
+  const size_t packets = std::max(0L, dissCtx->pending.load());
+  const size_t bytes = dissCtx->queuedBytes;
+  if ((maxPackets > 0 && packets >= maxPackets) ||
+      (maxBytes > 0 && bytes >= maxBytes)) {
+    overloaded = true;
+  } else if ((maxPackets == 0 || packets <= maxPackets / 2) &&
+             (maxBytes == 0 || bytes <= maxBytes / 2)) {
+    overloaded = false;
+  }
+  return overloaded;
+}
+
 PacketDispatcher::PacketDispatcher(const std::shared_ptr<Context> &ctx)
     : d(std::make_shared<Private>(ctx)) {}
 
 PacketDispatcher::~PacketDispatcher() {}
 
-void PacketDispatcher::analyze(std::unique_ptr<Packet> packet) {
+void PacketDispatcher::analyze(std::unique_ptr<Packet> packet,
+                               bool captured) {
+  DissectorSharedContext &ctx = *d->dissCtx;
+
+  // Packets that already have a sequence number are re-dissections of
+  // stored ones and are never shed.
+  if (packet->seq() == 0) {
+    if (captured && d->overflowing()) {
+      switch (d->policy) {
+      case OVERFLOW_BLOCK: {
+        std::unique_lock<std::mutex> lock(ctx.mutex);
+        ++ctx.blocked;
+        ctx.spaceCond.wait(lock, [this]() { return !d->overflowing(); });
+        --ctx.blocked;
+      } break;
+      case OVERFLOW_DROP:
+        ++d->dropped;
+        return;
+      case OVERFLOW_RAW: {
+        packet->setSeq(++d->packetSeq);
+        std::shared_ptr<Packet> pkt(std::move(packet));
+        pkt->buildLayerIndex();
+        ++d->rawOnly;
+        if (ctx.packetCb)
+          ctx.packetCb(pkt);
+        return;
+      }
+      }
+    }
+    packet->setSeq(++d->packetSeq);
+  }
+
+  const size_t length = packet->length();
+  PacketQueue &queue = *ctx.queues[ctx.nextQueue++ % ctx.queues.size()];
   {
-    std::lock_guard<std::mutex> lock(d->dissCtx->mutex);
-    if (packet->seq() == 0) {
-      packet->setSeq(++d->packetSeq);
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.packets.push_back(std::move(packet));
+  }
+  ctx.queuedBytes += length;
+  ++ctx.pending;
+
+  // Sleeping threads register in |idle| before checking |pending|, so one
+  // of the two sides always sees the other.
+  if (ctx.idle > 0) {
+    { std::lock_guard<std::mutex> lock(ctx.mutex); }
+    ctx.cond.notify_one();
+  }
+}
+
+uint32_t PacketDispatcher::reload(const Dissector &dissector,
+                                  DissectorNamespaces *oldNamespaces) {
+  DissectorSharedContext &ctx = *d->dissCtx;
+  const std::string &resourceName = dissector.resourceName;
+  const bool removed = dissector.script.empty() && dissector.native.empty();
+  std::lock_guard<std::mutex> lock(ctx.mutex);
+  ctx.dissectors.erase(std::remove_if(ctx.dissectors.begin(),
+                                      ctx.dissectors.end(),
+                                      [&resourceName](const Dissector &diss) {
+                                        return diss.resourceName ==
+                                               resourceName;
+                                      }),
+                       ctx.dissectors.end());
+  if (!removed) {
+    ctx.dissectors.push_back(dissector);
+  }
+
+  auto it = ctx.namespaces.find(resourceName);
+  if (it != ctx.namespaces.end()) {
+    *oldNamespaces = it->second;
+    ctx.namespaces.erase(it);
+  }
+
+  const uint32_t generation = ++ctx.generation;
+  ctx.cond.notify_all();
+  return generation;
+}
+
+bool PacketDispatcher::waitLoaded(uint32_t generation,
+                                  std::chrono::milliseconds timeout) {
+  DissectorSharedContext &ctx = *d->dissCtx;
+  std::unique_lock<std::mutex> lock(ctx.mutex);
+  return ctx.loadCond.wait_for(lock, timeout, [&ctx, generation] {
+    return ctx.loadedGeneration >= generation;
+  });
+}
+
+bool PacketDispatcher::waitLoaded(std::chrono::milliseconds timeout) {
+  DissectorSharedContext &ctx = *d->dissCtx;
+  std::unique_lock<std::mutex> lock(ctx.mutex);
+  const uint32_t generation = ctx.generation;
+  return ctx.loadCond.wait_for(lock, timeout, [&ctx, generation] {
+    return ctx.loadedGeneration >= generation;
+  });
+}
+
+// Namespaces are only known once a thread has evaluated the script.
+DissectorNamespaces
+PacketDispatcher::namespaces(const std::string &resourceName) const {
+  DissectorSharedContext &ctx = *d->dissCtx;
+  std::lock_guard<std::mutex> lock(ctx.mutex);
+  const auto it = ctx.namespaces.find(resourceName);
+  if (it == ctx.namespaces.end())
+    return DissectorNamespaces();
+  return it->second;
+}
+
+PacketDispatcher::QueueStatus PacketDispatcher::queueStatus() const {
+  QueueStatus status;
+  status.packets = std::max(0L, d->dissCtx->pending.load());
+  status.bytes = d->dissCtx->queuedBytes;
+  status.dropped = d->dropped;
+  status.rawOnly = d->rawOnly;
+  status.overloaded = d->overloaded;
+  return status;
+}
+
+std::vector<DissectorStats> PacketDispatcher::stats() const {
+  DissectorSharedContext &ctx = *d->dissCtx;
+  std::vector<DissectorStats> list;
+  std::lock_guard<std::mutex> lock(ctx.statsMutex);
+  for (size_t i = 0; i < ctx.counters.size(); ++i) {
+    for (const auto &pair : ctx.counters[i]) {
+      list.emplace_back(pair.first, i, *pair.second);
     }
-    d->dissCtx->queue.push(std::move(packet));
   }
-  d->dissCtx->cond.notify_all();
+  return list;
 }
@@ -2,33 +2,85 @@
 #define PACKET_DISPATCHER_HPP
 
 #include "dissector.hpp"
+#include "dissector_stats.hpp"
+#include "watchdog.hpp"
+#include <atomic>
+#include <chrono>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <vector>
-#include <queue>
+#include <string>
+#include <unordered_map>
 #include <mutex>
 #include <condition_variable>
 
 class StreamChunk;
 class Layer;
 class Packet;
+class NamespaceTable;
 struct LogMessage;
 
+struct PacketQueue {
+  std::mutex mutex;
+  std::deque<std::unique_ptr<Packet>> packets;
+};
+
 struct DissectorSharedContext {
+  DissectorSharedContext()
+      : nextQueue(0), pending(0), queuedBytes(0), idle(0), blocked(0) {}
+
   std::vector<Dissector> dissectors;
   std::function<void(const std::shared_ptr<Packet> &)> packetCb;
   std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
       streamsCb;
   std::function<void(const LogMessage &)> logCb;
-  std::queue<std::unique_ptr<Packet>> queue;
+  // One queue per thread; idle threads steal from the others.
+  std::vector<std::unique_ptr<PacketQueue>> queues;
+  std::atomic<size_t> nextQueue;
+  std::atomic<long> pending;
+  std::atomic<size_t> queuedBytes;
+  std::atomic<int> idle;
   std::mutex mutex;
   std::condition_variable cond;
+
+  // Producers waiting for the queues to drain below the high-water mark.
+  std::atomic<int> blocked;
+  std::condition_variable spaceCond;
+
+  // Bumped whenever |dissectors| changes; threads reload on mismatch.
+  uint32_t generation = 1;
+  uint32_t loadedGeneration = 0;
+  std::condition_variable loadCond;
+  std::unordered_map<std::string, DissectorNamespaces> namespaces;
+  std::shared_ptr<const NamespaceTable> table;
+  uint32_t tableGeneration = 0;
+
+  // Profiling counters per thread, keyed by resourceName. Updating them
+  // takes no lock; |statsMutex| only guards adding entries and snapshots.
+  std::mutex statsMutex;
+  std::vector<
+      std::unordered_map<std::string, std::shared_ptr<DissectorCounters>>>
+      counters;
+
+  // Calls past the watchdog's budget are terminated, and a dissector is
+  // disabled after |maxTimeouts| of them. Also guarded by |statsMutex|.
+  std::shared_ptr<Watchdog> watchdog;
+  int maxTimeouts = 0;
+  std::unordered_map<std::string, std::shared_ptr<DissectorHealth>> health;
 };
 
 class PacketDispatcher {
 public:
+  enum OverflowPolicy { OVERFLOW_BLOCK, OVERFLOW_DROP, OVERFLOW_RAW };
+
   struct Context {
     int threads;
+    size_t maxQueuedPackets = 0;
+    size_t maxQueuedBytes = 0;
+    OverflowPolicy overflowPolicy = OVERFLOW_BLOCK;
+    std::shared_ptr<Watchdog> watchdog;
+    int maxTimeouts = 0;
     std::vector<Dissector> dissectors;
     std::function<void(const std::shared_ptr<Packet> &)> packetCb;
     std::function<void(uint32_t, std::vector<std::unique_ptr<StreamChunk>>)>
@@ -36,12 +88,34 @@ public:
     std::function<void(const LogMessage &)> logCb;
   };
 
+  struct QueueStatus {
+    size_t packets;
+    size_t bytes;
+    uint64_t dropped;
+    uint64_t rawOnly;
+    bool overloaded;
+  };
+
 public:
   PacketDispatcher(const std::shared_ptr<Context> &ctx);
   ~PacketDispatcher();
   PacketDispatcher(const PacketDispatcher &) = delete;
   PacketDispatcher &operator=(const PacketDispatcher &) = delete;
-  void analyze(std::unique_ptr<Packet> packet);
+  // Only captured packets are subject to the overflow policy; packets from
+  // scripts and stream dissectors are always queued.
+  void analyze(std::unique_ptr<Packet> packet, bool captured = false);
+  // Swaps |dissector| in and returns the generation the threads have to
+  // load. A dissector without a script or native name is removed.
+  uint32_t reload(const Dissector &dissector,
+                  DissectorNamespaces *oldNamespaces);
+  // Returns false if no thread has loaded |generation| within |timeout|.
+  bool waitLoaded(uint32_t generation, std::chrono::milliseconds timeout);
+  // Waits for the current generation.
+  bool waitLoaded(std::chrono::milliseconds timeout);
+  DissectorNamespaces namespaces(const std::string &resourceName) const;
+  QueueStatus queueStatus() const;
+  // One entry per dissector and thread.
+  std::vector<DissectorStats> stats() const;
 
 private:
   class Private;
@@ -1,37 +1,119 @@
 #include "packet_store.hpp"
+#include "address.hpp"
+#include "buffer.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
 #include "packet.hpp"
+#include "payload_index.hpp"
+#include <algorithm>
+#include <iterator>
 #include <map>
 #include <unordered_map>
+#include <unordered_set>
 #include <uv.h>
 
+namespace {
+// Non-string values are stored under the key without a value so that lookups
+// can hand them to the filter, which decides how they compare.
+std::string indexKey(uint32_t layerId, const std::string &attr,
+                     const std::string *value) {
+  std::string key = std::to_string(layerId);
+  key += '\0';
+  key += attr;
+  key += '\0';
+  if (value) {
+    key += '=';
+    key += *value;
+  }
+  return key;
+}
+
+void addSeq(std::vector<uint32_t> *seqs, uint32_t seq) {
+  if (seqs->empty() || seqs->back() < seq) {
+    seqs->push_back(seq);
+    return;
+  }
+  auto it = std::lower_bound(seqs->begin(), seqs->end(), seq);
+  if (*it != seq)
+    seqs->insert(it, seq);
+}
+
+std::pair<std::vector<uint32_t>::const_iterator,
+          std::vector<uint32_t>::const_iterator>
+seqRange(const std::vector<uint32_t> &seqs, uint32_t start, uint32_t end) {
+  return std::make_pair(std::lower_bound(seqs.begin(), seqs.end(), start),
+                        std::upper_bound(seqs.begin(), seqs.end(), end));
+}
+}
+
 class PacketStore::Private {
 public:
   Private();
   ~Private();
+  void indexPacket(const Packet &pkt);
+  void indexPayload(const Packet &pkt);
 
 public:
   uv_rwlock_t rwlock;
   std::unordered_map<int, std::function<void(uint32_t)>> handlers;
   uint32_t maxSeq = 0;
   std::map<uint32_t, std::shared_ptr<Packet>> packets;
+  std::unordered_set<std::string> indexedAttrs = {"src", "dst"};
+  std::unordered_map<std::string, std::vector<uint32_t>> index;
+  std::unique_ptr<PayloadIndex> payloadIndex;
 };
 
 PacketStore::Private::Private() { uv_rwlock_init(&rwlock); }
 
 PacketStore::Private::~Private() { uv_rwlock_destroy(&rwlock); }
 
+void PacketStore::Private::indexPacket(const Packet &pkt) {
+  for (const auto &pair : pkt.indexedLayers()) {
+    const auto &attrs = pair.second->attrs();
+    for (const std::string &attr : indexedAttrs) {
+      const auto it = attrs.find(attr);
+      if (it == attrs.end())
+        continue;
+      const ItemValue &value = it->second;
+      std::string formatted;
+      const std::string *str = nullptr;
+      if (value.base() == ItemValue::STRING) {
+        str = &value.string();
+      } else if (value.base() == ItemValue::ADDRESS) {
+        formatted = Address::format(value.address().data(),
+                                    value.address().size());
+        str = &formatted;
+      }
+      addSeq(&index[indexKey(pair.first, attr, str)], pkt.seq());
+    }
+  }
+}
+
 PacketStore::PacketStore() : d(new Private()) {}
 
 PacketStore::~PacketStore() {}
 
+void PacketStore::Private::indexPayload(const Packet &pkt) {
+  if (std::unique_ptr<Buffer> payload = pkt.payload()) {
+    payloadIndex->insert(pkt.seq(), payload->data(), payload->length());
+  }
+}
+
 void PacketStore::insert(const std::shared_ptr<Packet> &pkt) {
   uv_rwlock_wrlock(&d->rwlock);
   d->packets[pkt->seq()] = pkt;
+  d->indexPacket(*pkt);
   uint32_t seq = d->maxSeq;
   for (auto it = d->packets.find(seq + 1); it != d->packets.end();
        seq++, it = d->packets.find(seq + 1))
     ;
   if (d->maxSeq < seq) {
+    if (d->payloadIndex) {
+      for (auto it = d->packets.find(d->maxSeq + 1);
+           it != d->packets.end() && it->first <= seq; ++it) {
+        d->indexPayload(*it->second);
+      }
+    }
     d->maxSeq = seq;
     for (const auto &pair : d->handlers) {
       if (pair.second)
@@ -68,6 +150,44 @@ std::shared_ptr<Packet> PacketStore::get(uint32_t seq) const {
 
 uint32_t PacketStore::maxSeq() const { return d->maxSeq; }
 
+void PacketStore::setIndexedAttrs(const std::vector<std::string> &attrs) {
+  uv_rwlock_wrlock(&d->rwlock);
+  d->indexedAttrs = std::unordered_set<std::string>(attrs.begin(), attrs.end());
+  d->index.clear();
+  for (const auto &pair : d->packets) {
+    d->indexPacket(*pair.second);
+  }
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+bool PacketStore::isIndexedAttr(const std::string &attr) const {
+  uv_rwlock_rdlock(&d->rwlock);
+  bool indexed = d->indexedAttrs.count(attr) > 0;
+  uv_rwlock_rdunlock(&d->rwlock);
+  return indexed;
+}
+
+std::vector<uint32_t> PacketStore::lookup(uint32_t layerId,
+                                          const std::string &attr,
+                                          const std::string &value,
+                                          uint32_t start, uint32_t end) const {
+  std::vector<uint32_t> seqs;
+  if (start > end)
+    return seqs;
+  static const std::vector<uint32_t> empty;
+  uv_rwlock_rdlock(&d->rwlock);
+  auto it = d->index.find(indexKey(layerId, attr, &value));
+  const auto &matched =
+      seqRange(it != d->index.end() ? it->second : empty, start, end);
+  it = d->index.find(indexKey(layerId, attr, nullptr));
+  const auto &untyped =
+      seqRange(it != d->index.end() ? it->second : empty, start, end);
+  std::merge(matched.first, matched.second, untyped.first, untyped.second,
+             std::back_inserter(seqs));
+  uv_rwlock_rdunlock(&d->rwlock);
+  return seqs;
+}
+
 int PacketStore::addHandler(const std::function<void(uint32_t)> &cb) {
   static int handlerId = 0;
   int id = ++handlerId;
@@ -82,3 +202,35 @@ void PacketStore::removeHandler(int id) {
   d->handlers.erase(id);
   uv_rwlock_wrunlock(&d->rwlock);
 }
+
+void PacketStore::setPayloadIndexEnabled(bool enabled) {
+  uv_rwlock_wrlock(&d->rwlock);
+  if (!enabled) {
+    d->payloadIndex.reset();
+  } else if (!d->payloadIndex) {
+    d->payloadIndex.reset(new PayloadIndex());
+    for (auto it = d->packets.begin();
+         it != d->packets.end() && it->first <= d->maxSeq; ++it) {
+      d->indexPayload(*it->second);
+    }
+  }
+  uv_rwlock_wrunlock(&d->rwlock);
+}
+
+bool PacketStore::isPayloadIndexed() const {
+  uv_rwlock_rdlock(&d->rwlock);
+  bool indexed = static_cast<bool>(d->payloadIndex);
+  uv_rwlock_rdunlock(&d->rwlock);
+  return indexed;
+}
+
+std::vector<uint32_t> PacketStore::lookupPayload(const std::string &needle,
+                                                 uint32_t start,
+                                                 uint32_t end) const {
+  std::vector<uint32_t> seqs;
+  uv_rwlock_rdlock(&d->rwlock);
+  if (d->payloadIndex)
+    seqs = d->payloadIndex->lookup(needle, start, end);
+  uv_rwlock_rdunlock(&d->rwlock);
+  return seqs;
+}
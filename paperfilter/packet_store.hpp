@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 class Packet;
@@ -17,6 +18,15 @@ public:
   std::vector<std::shared_ptr<Packet>> get(uint32_t start, uint32_t end) const;
   std::shared_ptr<Packet> get(uint32_t seq) const;
   uint32_t maxSeq() const;
+  void setIndexedAttrs(const std::vector<std::string> &attrs);
+  bool isIndexedAttr(const std::string &attr) const;
+  std::vector<uint32_t> lookup(uint32_t layerId, const std::string &attr,
+                               const std::string &value, uint32_t start,
+                               uint32_t end) const;
+  void setPayloadIndexEnabled(bool enabled);
+  bool isPayloadIndexed() const;
+  std::vector<uint32_t> lookupPayload(const std::string &needle,
+                                      uint32_t start, uint32_t end) const;
   int addHandler(const std::function<void(uint32_t)> &cb);
   void removeHandler(int id);
 
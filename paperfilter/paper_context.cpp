@@ -36,12 +36,26 @@ void initModule(v8pp::module *module, v8::Isolate *isolate) {
   Buffer_class.set("toString", &Buffer::toString);
   Buffer_class.set("valueOf", &Buffer::valueOf);
   Buffer_class.set("indexOf", &Buffer::indexOf);
+  Buffer_class.set("arrayBuffer", &Buffer::arrayBuffer);
+  Buffer_class.set("uint8Array", &Buffer::uint8Array);
+  Buffer_class.set("dataView", &Buffer::dataView);
   Buffer_class.set("readInt8", &Buffer::readInt8);
   Buffer_class.set("readInt16BE", &Buffer::readInt16BE);
+  Buffer_class.set("readInt16LE", &Buffer::readInt16LE);
   Buffer_class.set("readInt32BE", &Buffer::readInt32BE);
+  Buffer_class.set("readInt32LE", &Buffer::readInt32LE);
+  Buffer_class.set("readInt64BE", &Buffer::readInt64BE);
+  Buffer_class.set("readInt64LE", &Buffer::readInt64LE);
   Buffer_class.set("readUInt8", &Buffer::readUInt8);
   Buffer_class.set("readUInt16BE", &Buffer::readUInt16BE);
+  Buffer_class.set("readUInt16LE", &Buffer::readUInt16LE);
   Buffer_class.set("readUInt32BE", &Buffer::readUInt32BE);
+  Buffer_class.set("readUInt32LE", &Buffer::readUInt32LE);
+  Buffer_class.set("readUInt64BE", &Buffer::readUInt64BE);
+  Buffer_class.set("readUInt64LE", &Buffer::readUInt64LE);
+  Buffer_class.set("unpack", &Buffer::unpack);
+  Buffer_class.set("checksum", &Buffer::checksum);
+  Buffer_class.set("pseudoHeaderChecksum", &Buffer::pseudoHeaderChecksum);
 
   Buffer_class.class_function_template()
       ->PrototypeTemplate()
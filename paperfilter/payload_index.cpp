@@ -0,0 +1,146 @@
+#include "payload_index.hpp"
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+
+namespace {
+// Seqs are grouped into segments so that a posting list only stores small
+// deltas from the previous seq in the same segment.
+const uint32_t segmentBits = 16;
+
+uint32_t trigram(const char *data) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data);
+  return (bytes[0] << 16) | (bytes[1] << 8) | bytes[2];
+}
+
+std::vector<uint32_t> trigrams(const char *data, size_t length) {
+  std::vector<uint32_t> grams;
+  if (length < 3)
+    return grams;
+  grams.reserve(length - 2);
+  for (size_t i = 0; i + 3 <= length; ++i) {
+    grams.push_back(trigram(data + i));
+  }
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  return grams;
+}
+
+class Posting {
+public:
+  void append(uint32_t seq) {
+    uint32_t delta = seq - last;
+    while (delta >= 0x80) {
+      bytes.push_back(static_cast<char>((delta & 0x7f) | 0x80));
+      delta >>= 7;
+    }
+    bytes.push_back(static_cast<char>(delta));
+    last = seq;
+    count++;
+  }
+
+  std::vector<uint32_t> decode(uint32_t base) const {
+    std::vector<uint32_t> seqs;
+    seqs.reserve(count);
+    uint32_t seq = base;
+    uint32_t delta = 0;
+    int shift = 0;
+    for (char c : bytes) {
+      delta |= static_cast<uint32_t>(c & 0x7f) << shift;
+      if (c & 0x80) {
+        shift += 7;
+        continue;
+      }
+      seq += delta;
+      seqs.push_back(seq);
+      delta = 0;
+      shift = 0;
+    }
+    return seqs;
+  }
+
+public:
+  uint32_t last = 0;
+  uint32_t count = 0;
+  std::string bytes;
+};
+
+struct Segment {
+  std::unordered_map<uint32_t, Posting> postings;
+};
+}
+
+class PayloadIndex::Private {
+public:
+  std::map<uint32_t, Segment> segments;
+};
+
+PayloadIndex::PayloadIndex() : d(new Private()) {}
+
+PayloadIndex::~PayloadIndex() {}
+
+void PayloadIndex::insert(uint32_t seq, const char *data, size_t length) {
+  const std::vector<uint32_t> &grams = trigrams(data, length);
+  if (grams.empty())
+    return;
+  uint32_t segment = seq >> segmentBits;
+  Segment &seg = d->segments[segment];
+  for (uint32_t gram : grams) {
+    auto it = seg.postings.find(gram);
+    if (it == seg.postings.end()) {
+      it = seg.postings.emplace(gram, Posting()).first;
+      it->second.last = segment << segmentBits;
+    }
+    if (it->second.count == 0 || it->second.last < seq)
+      it->second.append(seq);
+  }
+}
+
+std::vector<uint32_t> PayloadIndex::lookup(const std::string &needle,
+                                           uint32_t start,
+                                           uint32_t end) const {
+  std::vector<uint32_t> seqs;
+  if (start > end || !isIndexable(needle))
+    return seqs;
+  const std::vector<uint32_t> &grams = trigrams(needle.data(), needle.size());
+  auto first = d->segments.lower_bound(start >> segmentBits);
+  auto last = d->segments.upper_bound(end >> segmentBits);
+  for (auto it = first; it != last; ++it) {
+    const Segment &seg = it->second;
+    std::vector<const Posting *> postings;
+    for (uint32_t gram : grams) {
+      const auto posting = seg.postings.find(gram);
+      if (posting == seg.postings.end()) {
+        postings.clear();
+        break;
+      }
+      postings.push_back(&posting->second);
+    }
+    if (postings.empty())
+      continue;
+    std::sort(postings.begin(), postings.end(),
+              [](const Posting *a, const Posting *b) {
+                return a->count < b->count;
+              });
+
+    uint32_t base = it->first << segmentBits;
+    std::vector<uint32_t> matched = postings[0]->decode(base);
+    for (size_t i = 1; i < postings.size() && !matched.empty(); ++i) {
+      const std::vector<uint32_t> &other = postings[i]->decode(base);
+      std::vector<uint32_t> both;
+      std::set_intersection(matched.begin(), matched.end(), other.begin(),
+                            other.end(), std::back_inserter(both));
+      matched.swap(both);
+    }
+    for (uint32_t seq : matched) {
+      if (seq >= start && seq <= end)
+        seqs.push_back(seq);
+    }
+  }
+  return seqs;
+}
+
+bool PayloadIndex::isIndexable(const std::string &needle) {
+  return needle.size() >= 3;
+}
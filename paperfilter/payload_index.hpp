@@ -0,0 +1,25 @@
+#ifndef PAYLOAD_INDEX_HPP
+#define PAYLOAD_INDEX_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PayloadIndex {
+public:
+  PayloadIndex();
+  ~PayloadIndex();
+  PayloadIndex(const PayloadIndex &) = delete;
+  PayloadIndex &operator=(const PayloadIndex &) = delete;
+  void insert(uint32_t seq, const char *data, size_t length);
+  std::vector<uint32_t> lookup(const std::string &needle, uint32_t start,
+                               uint32_t end) const;
+  static bool isIndexable(const std::string &needle);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "session.hpp"
 #include "buffer.hpp"
+#include "code_cache.hpp"
 #include "dissector.hpp"
 #include "packet_dispatcher.hpp"
 #include "filter_thread.hpp"
@@ -11,6 +12,9 @@
 #include "stream_chunk.hpp"
 #include "stream_dispatcher.hpp"
 #include "log_message.hpp"
+#include "watchdog.hpp"
+#include <algorithm>
+#include <atomic>
 #include <nan.h>
 #include <thread>
 #include <chrono>
@@ -21,6 +25,13 @@
 
 using namespace v8;
 
+// Callbacks of a pipeline hold the gate while they touch the session, so
+// closing it guarantees that none of them will again.
+struct PipelineGate {
+  std::mutex mutex;
+  bool open = true;
+};
+
 struct FilterContext {
   std::vector<std::unique_ptr<FilterThread>> threads;
   std::shared_ptr<FilterThread::Context> ctx;
@@ -29,22 +40,199 @@ struct FilterContext {
   uint32_t initialMaxSeq = 0;
 };
 
+namespace {
+// Loading every dissector may take a while on a cold code cache.
+const std::chrono::milliseconds loadTimeout(30000);
+const std::chrono::milliseconds reloadTimeout(5000);
+
+// Times are reported in milliseconds like the rest of the status.
+Local<Object> statsObject(Isolate *isolate, const DissectorStats &stats) {
+  Local<Object> obj = Object::New(isolate);
+  v8pp::set_option(isolate, obj, "calls", static_cast<double>(stats.calls));
+  v8pp::set_option(isolate, obj, "time", stats.totalNsec / 1e6);
+  v8pp::set_option(isolate, obj, "maxTime", stats.maxNsec / 1e6);
+  v8pp::set_option(isolate, obj, "errors", static_cast<double>(stats.errors));
+  v8pp::set_option(isolate, obj, "layers", static_cast<double>(stats.layers));
+  v8pp::set_option(isolate, obj, "chunks", static_cast<double>(stats.chunks));
+  return obj;
+}
+
+void dispatch(PacketDispatcher *dispatcher, const std::string &ns,
+              std::unique_ptr<Packet> pkt, bool captured = false) {
+  const auto &layer = std::make_shared<Layer>(ns);
+  layer->setName("Raw Layer");
+  layer->setPayload(pkt->payload());
+  pkt->addLayer(layer);
+  dispatcher->analyze(std::move(pkt), captured);
+}
+
+// Drains a replaced pipeline and feeds its packets to the new one without
+// blocking the loop. The callback runs once the new dissectors are loaded.
+struct ResetWork {
+  static void run(uv_work_t *req);
+  static void done(uv_work_t *req, int status);
+
+  uv_work_t req;
+  std::string ns;
+  std::unordered_map<std::string, FilterContext> filterThreads;
+  std::unique_ptr<StreamDispatcher> streamDispatcher;
+  std::unique_ptr<Pcap> pcap;
+  std::shared_ptr<PacketDispatcher> packetDispatcher;
+  std::shared_ptr<PacketStore> store;
+  std::shared_ptr<PacketDispatcher> dispatcher;
+  std::function<void(const LogMessage &)> logCb;
+  std::string error;
+  UniquePersistent<Function> callback;
+};
+
+void ResetWork::run(uv_work_t *req) {
+  ResetWork *work = static_cast<ResetWork *>(req->data);
+  std::vector<std::shared_ptr<Packet>> packets;
+  if (work->store) {
+    packets = work->store->get(1, work->store->maxSeq());
+  }
+  work->filterThreads.clear();
+  work->streamDispatcher.reset();
+  work->pcap.reset();
+  work->packetDispatcher.reset();
+  work->store.reset();
+
+  for (const auto &pkt : packets) {
+    if (!pkt->vpacket()) {
+      dispatch(work->dispatcher.get(), work->ns, pkt->shallowClone());
+    }
+  }
+  // A thread stuck in a script must not hold this worker forever.
+  if (!work->dispatcher->waitLoaded(loadTimeout)) {
+    work->error = "Dissectors did not load within " +
+                  std::to_string(loadTimeout.count()) + " ms";
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_ERROR;
+    msg.message = work->error;
+    msg.domain = "dissector";
+    work->logCb(msg);
+  }
+}
+
+// Waits for the threads to load a reloaded dissector and re-dissects the
+// stored packets it applies to, without blocking the loop.
+struct ReloadWork {
+  static void run(uv_work_t *req);
+  static void done(uv_work_t *req, int status);
+
+  uv_work_t req;
+  std::string resourceName;
+  uint32_t generation;
+  DissectorNamespaces oldNamespaces;
+  std::shared_ptr<PacketStore> store;
+  std::shared_ptr<PacketDispatcher> dispatcher;
+  // Registers the clones with the session; false once it has been reset.
+  std::function<bool(uint32_t, size_t)> pendingCb;
+  std::function<void(const LogMessage &)> logCb;
+  std::string error;
+  UniquePersistent<Function> callback;
+};
+
+void ReloadWork::run(uv_work_t *req) {
+  ReloadWork *work = static_cast<ReloadWork *>(req->data);
+  if (!work->dispatcher->waitLoaded(work->generation, reloadTimeout)) {
+    work->error = "Dissector did not load within " +
+                  std::to_string(reloadTimeout.count()) + " ms";
+    LogMessage msg;
+    msg.level = LogMessage::LEVEL_ERROR;
+    msg.message = work->error;
+    msg.domain = "dissector";
+    msg.resourceName = work->resourceName;
+    work->logCb(msg);
+    return;
+  }
+
+  const DissectorNamespaces &oldNamespaces = work->oldNamespaces;
+  const DissectorNamespaces &newNamespaces =
+      work->dispatcher->namespaces(work->resourceName);
+  std::unordered_map<std::string, bool> matches;
+  auto affected = [&](const std::string &ns) {
+    auto it = matches.find(ns);
+    if (it == matches.end()) {
+      bool match = oldNamespaces.match(ns) || newNamespaces.match(ns);
+      it = matches.emplace(ns, match).first;
+    }
+    return it->second;
+  };
+
+  uint32_t maxSeq = work->store->maxSeq();
+  std::vector<std::unique_ptr<Packet>> packets;
+  for (const auto &pkt : work->store->get(1, maxSeq)) {
+    if (std::unique_ptr<Packet> clone = pkt->partialClone(affected)) {
+      packets.push_back(std::move(clone));
+    }
+  }
+  if (packets.empty() || !work->pendingCb(maxSeq, packets.size()))
+    return;
+  for (auto &pkt : packets) {
+    work->dispatcher->analyze(std::move(pkt));
+  }
+}
+
+void ReloadWork::done(uv_work_t *req, int status) {
+  ReloadWork *work = static_cast<ReloadWork *>(req->data);
+  if (!work->callback.IsEmpty()) {
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope(isolate);
+    Local<Function> func = Local<Function>::New(isolate, work->callback);
+    Local<Value> args[1] = {Null(isolate)};
+    if (!work->error.empty())
+      args[0] = v8pp::to_v8(isolate, work->error);
+    func->Call(isolate->GetCurrentContext()->Global(), 1, args);
+  }
+  delete work;
+}
+
+void ResetWork::done(uv_work_t *req, int status) {
+  ResetWork *work = static_cast<ResetWork *>(req->data);
+  if (!work->callback.IsEmpty()) {
+    Isolate *isolate = Isolate::GetCurrent();
+    HandleScope scope(isolate);
+    Local<Function> func = Local<Function>::New(isolate, work->callback);
+    Local<Value> args[1] = {Null(isolate)};
+    if (!work->error.empty())
+      args[0] = v8pp::to_v8(isolate, work->error);
+    func->Call(isolate->GetCurrentContext()->Global(), 1, args);
+  }
+  delete work;
+}
+}
+
 class Session::Private {
 public:
   Private();
   ~Private();
   void log(const LogMessage &msg);
+  std::function<void(const LogMessage &)>
+  gatedLog(const std::shared_ptr<PipelineGate> &gate);
+  void filter(const std::string &name, const std::string &filter);
+  void refilter();
+  std::vector<DissectorStats> stats() const;
 
 public:
-  std::unique_ptr<PacketStore> store;
-  std::unique_ptr<PacketDispatcher> packetDispatcher;
+  std::shared_ptr<PacketStore> store;
+  std::shared_ptr<PacketDispatcher> packetDispatcher;
+  std::shared_ptr<PipelineGate> gate;
+  std::shared_ptr<Watchdog> watchdog;
   std::unordered_map<std::string, FilterContext> filterThreads;
   std::string ns;
+  std::string overflowPolicy = "block";
 
   UniquePersistent<Function> statusCb;
   UniquePersistent<Function> logCb;
   uv_async_t statusCbAsync;
   uv_async_t logCbAsync;
+  uv_async_t reloadAsync;
+
+  // Packets up to |reloadMaxSeq| that are still being re-dissected after
+  // a dissector reload.
+  std::atomic<uint32_t> reloadMaxSeq;
+  std::atomic<uint32_t> pendingReloads;
 
   std::unique_ptr<StreamDispatcher> streamDispatcher;
   std::unique_ptr<Pcap> pcap;
@@ -56,7 +244,7 @@ public:
   int threads;
 };
 
-Session::Private::Private() {
+Session::Private::Private() : reloadMaxSeq(0), pendingReloads(0) {
   logCbAsync.data = this;
   uv_async_init(uv_default_loop(), &logCbAsync, [](uv_async_t *handle) {
     Session::Private *d = static_cast<Session::Private *>(handle->data);
@@ -96,6 +284,13 @@ Session::Private::Private() {
     }
   });
 
+  // Filters ran against the old layers while packets were re-dissected.
+  reloadAsync.data = this;
+  uv_async_init(uv_default_loop(), &reloadAsync, [](uv_async_t *handle) {
+    Session::Private *d = static_cast<Session::Private *>(handle->data);
+    d->refilter();
+  });
+
   statusCbAsync.data = this;
   uv_async_init(uv_default_loop(), &statusCbAsync, [](uv_async_t *handle) {
     Session::Private *d = static_cast<Session::Private *>(handle->data);
@@ -127,6 +322,31 @@ Session::Private::Private() {
       }
 
       v8pp::set_option(isolate, obj, "filtered", filtered);
+
+      const PacketDispatcher::QueueStatus &queue =
+          d->packetDispatcher->queueStatus();
+      Local<Object> queueObj = Object::New(isolate);
+      v8pp::set_option(isolate, queueObj, "packets", queue.packets);
+      v8pp::set_option(isolate, queueObj, "bytes", queue.bytes);
+      v8pp::set_option(isolate, queueObj, "dropped",
+                       static_cast<double>(queue.dropped));
+      v8pp::set_option(isolate, queueObj, "rawOnly",
+                       static_cast<double>(queue.rawOnly));
+      v8pp::set_option(isolate, queueObj, "mode",
+                       queue.overloaded ? d->overflowPolicy : "normal");
+      v8pp::set_option(isolate, obj, "queue", queueObj);
+
+      std::unordered_map<std::string, DissectorStats> totals;
+      for (const DissectorStats &stats : d->stats()) {
+        totals[stats.resourceName].merge(stats);
+      }
+      Local<Object> dissectors = Object::New(isolate);
+      for (const auto &pair : totals) {
+        v8pp::set_option(isolate, dissectors, pair.first.c_str(),
+                         statsObject(isolate, pair.second));
+      }
+      v8pp::set_option(isolate, obj, "dissectors", dissectors);
+
       Handle<Value> args[1] = {obj};
       Local<Function> func = Local<Function>::New(isolate, d->statusCb);
       func->Call(isolate->GetCurrentContext()->Global(), 1, args);
@@ -134,6 +354,62 @@ Session::Private::Private() {
   });
 }
 
+std::function<void(const LogMessage &)>
+Session::Private::gatedLog(const std::shared_ptr<PipelineGate> &gate) {
+  return [this, gate](const LogMessage &msg) {
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    if (gate->open)
+      log(msg);
+  };
+}
+
+void Session::Private::filter(const std::string &name,
+                              const std::string &filter) {
+  filterThreads.erase(name);
+
+  if (!filter.empty()) {
+    FilterContext &context = filterThreads[name];
+    context.initialMaxSeq = store->maxSeq();
+    context.ctx = std::make_shared<FilterThread::Context>();
+    context.ctx->store = store.get();
+    context.ctx->filter = filter;
+    context.ctx->watchdog = watchdog;
+    // Filter threads outlive a reset on the threadpool, so they only reach
+    // the session through the gate like the rest of the pipeline.
+    const std::shared_ptr<PipelineGate> &gate = this->gate;
+    context.ctx->packets.addHandler([this, gate](uint32_t seq) {
+      std::lock_guard<std::mutex> lock(gate->mutex);
+      if (gate->open)
+        uv_async_send(&statusCbAsync);
+    });
+    context.ctx->logCb = gatedLog(gate);
+    for (int i = 0; i < threads; ++i) {
+      context.threads.emplace_back(new FilterThread(context.ctx));
+    }
+  }
+
+  uv_async_send(&statusCbAsync);
+}
+
+void Session::Private::refilter() {
+  std::vector<std::pair<std::string, std::string>> filters;
+  for (const auto &pair : filterThreads) {
+    filters.push_back(std::make_pair(pair.first, pair.second.ctx->filter));
+  }
+  filterThreads.clear();
+  for (const auto &pair : filters) {
+    filter(pair.first, pair.second);
+  }
+}
+
+// Packet and stream dissectors have distinct resource names.
+std::vector<DissectorStats> Session::Private::stats() const {
+  std::vector<DissectorStats> list = packetDispatcher->stats();
+  const std::vector<DissectorStats> &streams = streamDispatcher->stats();
+  list.insert(list.end(), streams.begin(), streams.end());
+  return list;
+}
+
 void Session::Private::log(const LogMessage &msg) {
   {
     std::lock_guard<std::mutex> lock(errorMutex);
@@ -143,46 +419,30 @@ void Session::Private::log(const LogMessage &msg) {
 }
 
 Session::Private::~Private() {
+  if (gate) {
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    gate->open = false;
+  }
   filterThreads.clear();
   streamDispatcher.reset();
   pcap.reset();
   uv_close((uv_handle_t *)&statusCbAsync, nullptr);
   uv_close((uv_handle_t *)&logCbAsync, nullptr);
+  uv_close((uv_handle_t *)&reloadAsync, nullptr);
 }
 
 Session::Session(v8::Local<v8::Object> option) : d(new Private()) {
-  reset(option);
+  reset(option, v8::Local<v8::Function>());
 }
 
 Session::~Session() {}
 
 void Session::analyze(std::unique_ptr<Packet> pkt) {
-  const auto &layer = std::make_shared<Layer>(d->ns);
-  layer->setName("Raw Layer");
-  layer->setPayload(pkt->payload());
-  pkt->addLayer(layer);
-  d->packetDispatcher->analyze(std::move(pkt));
+  dispatch(d->packetDispatcher.get(), d->ns, std::move(pkt));
 }
 
 void Session::filter(const std::string &name, const std::string &filter) {
-  d->filterThreads.erase(name);
-
-  if (!filter.empty()) {
-    FilterContext &context = d->filterThreads[name];
-    context.initialMaxSeq = d->store->maxSeq();
-    context.ctx = std::make_shared<FilterThread::Context>();
-    context.ctx->store = d->store.get();
-    context.ctx->filter = filter;
-    context.ctx->packets.addHandler(
-        [this](uint32_t seq) { uv_async_send(&d->statusCbAsync); });
-    context.ctx->logCb =
-        std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-    for (int i = 0; i < d->threads; ++i) {
-      context.threads.emplace_back(new FilterThread(context.ctx));
-    }
-  }
-
-  uv_async_send(&d->statusCbAsync);
+  d->filter(name, filter);
 }
 
 v8::Local<v8::Function> Session::logCallback() const {
@@ -215,6 +475,19 @@ std::vector<uint32_t> Session::getFiltered(const std::string &name,
 
 std::string Session::ns() const { return d->ns; }
 
+v8::Local<v8::Array> Session::stats() const {
+  Isolate *isolate = Isolate::GetCurrent();
+  const std::vector<DissectorStats> &list = d->stats();
+  Local<Array> array = Array::New(isolate, list.size());
+  for (size_t i = 0; i < list.size(); ++i) {
+    Local<Object> obj = statsObject(isolate, list[i]);
+    v8pp::set_option(isolate, obj, "resourceName", list[i].resourceName);
+    v8pp::set_option(isolate, obj, "thread", list[i].thread);
+    array->Set(i, obj);
+  }
+  return array;
+}
+
 bool Session::permission() { return Permission::test(); }
 
 v8::Local<v8::Array> Session::devices() {
@@ -260,15 +533,86 @@ void Session::stop() {
   uv_async_send(&d->statusCbAsync);
 }
 
-void Session::reset(v8::Local<v8::Object> opt) {
+void Session::reloadDissector(const std::string &resourceName,
+                              const std::string &script,
+                              const std::string &native,
+                              v8::Local<v8::Function> callback) {
+  ReloadWork *work = new ReloadWork();
+  work->req.data = work;
+  work->resourceName = resourceName;
+  work->generation = d->packetDispatcher->reload(
+      Dissector(script, resourceName, native), &work->oldNamespaces);
+  work->store = d->store;
+  work->dispatcher = d->packetDispatcher;
+  const std::shared_ptr<PipelineGate> gate = d->gate;
+  work->pendingCb = [this, gate](uint32_t maxSeq, size_t count) {
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    if (!gate->open)
+      return false;
+    d->reloadMaxSeq = std::max(d->reloadMaxSeq.load(), maxSeq);
+    d->pendingReloads += count;
+    return true;
+  };
+  work->logCb = d->gatedLog(gate);
+  if (!callback.IsEmpty())
+    work->callback.Reset(Isolate::GetCurrent(), callback);
+  uv_queue_work(uv_default_loop(), &work->req, ReloadWork::run,
+                ReloadWork::done);
+}
+
+void Session::ready(v8::Local<v8::Function> callback) {
+  ResetWork *work = new ResetWork();
+  work->req.data = work;
+  work->dispatcher = d->packetDispatcher;
+  work->logCb = d->gatedLog(d->gate);
+  work->callback.Reset(Isolate::GetCurrent(), callback);
+  uv_queue_work(uv_default_loop(), &work->req, ResetWork::run,
+                ResetWork::done);
+}
+
+void Session::reset(v8::Local<v8::Object> opt,
+                    v8::Local<v8::Function> callback) {
   Isolate *isolate = Isolate::GetCurrent();
 
-  v8pp::get_option(isolate, opt, "namespace", d->ns);
+  // The old pipeline reads |d->ns| until its gate is closed below.
+  std::string ns = d->ns;
+  v8pp::get_option(isolate, opt, "namespace", ns);
+
+  std::string codeCache;
+  if (v8pp::get_option(isolate, opt, "code_cache", codeCache)) {
+    CodeCache::setDirectory(codeCache);
+  }
 
   d->threads = std::thread::hardware_concurrency();
   v8pp::get_option(isolate, opt, "threads", d->threads);
   d->threads = std::max(1, d->threads - 1);
 
+  // Captured packets beyond the high-water mark are handled by the policy:
+  // "block" stalls the capture thread so the kernel drops, "drop" discards
+  // them, and "raw" stores them without dissection.
+  auto dissCtx = std::make_shared<PacketDispatcher::Context>();
+  v8pp::get_option(isolate, opt, "queue_limit", dissCtx->maxQueuedPackets);
+  v8pp::get_option(isolate, opt, "queue_limit_bytes",
+                   dissCtx->maxQueuedBytes);
+  v8pp::get_option(isolate, opt, "overflow_policy", d->overflowPolicy);
+  if (d->overflowPolicy == "drop") {
+    dissCtx->overflowPolicy = PacketDispatcher::OVERFLOW_DROP;
+  } else if (d->overflowPolicy == "raw") {
+    dissCtx->overflowPolicy = PacketDispatcher::OVERFLOW_RAW;
+  } else {
+    d->overflowPolicy = "block";
+    dissCtx->overflowPolicy = PacketDispatcher::OVERFLOW_BLOCK;
+  }
+
+  // Script calls running longer than |script_timeout| milliseconds are
+  // terminated, and a dissector is disabled after |script_timeout_limit|
+  // timeouts. Both are off by default.
+  uint32_t scriptTimeout = 0;
+  v8pp::get_option(isolate, opt, "script_timeout", scriptTimeout);
+  v8pp::get_option(isolate, opt, "script_timeout_limit",
+                   dissCtx->maxTimeouts);
+  dissCtx->watchdog = std::make_shared<Watchdog>(scriptTimeout);
+
   Local<Array> dissectorArray;
   std::vector<Dissector> dissectors;
   if (v8pp::get_option(isolate, opt, "dissectors", dissectorArray)) {
@@ -292,65 +636,118 @@ void Session::reset(v8::Local<v8::Object> opt) {
     }
   }
 
-  auto dissCtx = std::make_shared<PacketDispatcher::Context>();
+  // The old pipeline is closed here and torn down on a worker thread, so
+  // its threads can no longer reach the session.
+  ResetWork *work = new ResetWork();
+  work->req.data = work;
+  work->ns = ns;
+  if (!callback.IsEmpty())
+    work->callback.Reset(isolate, callback);
+  if (d->gate) {
+    std::lock_guard<std::mutex> lock(d->gate->mutex);
+    d->gate->open = false;
+  }
+  d->ns = ns;
+  std::vector<std::pair<std::string, std::string>> filters;
+  for (const auto &pair : d->filterThreads) {
+    filters.push_back(std::make_pair(pair.first, pair.second.ctx->filter));
+  }
+  work->filterThreads.swap(d->filterThreads);
+  work->streamDispatcher = std::move(d->streamDispatcher);
+  work->pcap = std::move(d->pcap);
+  work->packetDispatcher = std::move(d->packetDispatcher);
+  work->store = std::move(d->store);
+  d->reloadMaxSeq = 0;
+  d->pendingReloads = 0;
+
+  auto gate = std::make_shared<PipelineGate>();
+  d->gate = gate;
+  d->watchdog = dissCtx->watchdog;
+
   dissCtx->threads = d->threads;
-  dissCtx->packetCb = [this](const std::shared_ptr<Packet> &pkt) {
+  dissCtx->packetCb = [this, gate](const std::shared_ptr<Packet> &pkt) {
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    if (!gate->open)
+      return;
     d->store->insert(pkt);
+    if (pkt->seq() <= d->reloadMaxSeq && d->pendingReloads.fetch_sub(1) == 1)
+      uv_async_send(&d->reloadAsync);
   };
-  dissCtx->streamsCb = [this](
+  dissCtx->streamsCb = [this, gate](
       uint32_t seq, std::vector<std::unique_ptr<StreamChunk>> streams) {
-    d->streamDispatcher->insert(seq, std::move(streams));
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    if (gate->open)
+      d->streamDispatcher->insert(seq, std::move(streams));
   };
   dissCtx->dissectors.swap(dissectors);
-  dissCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-  d->packetDispatcher.reset(new PacketDispatcher(dissCtx));
+  dissCtx->logCb = d->gatedLog(gate);
+  d->packetDispatcher = std::make_shared<PacketDispatcher>(dissCtx);
+  work->dispatcher = d->packetDispatcher;
+  work->logCb = d->gatedLog(gate);
 
   auto streamCtx = std::make_shared<StreamDispatcher::Context>();
   streamCtx->threads = d->threads;
   streamCtx->dissectors.swap(streamDissectors);
-  streamCtx->logCb =
-      std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-  streamCtx->streamsCb = [this](
+  streamCtx->watchdog = dissCtx->watchdog;
+  streamCtx->maxTimeouts = dissCtx->maxTimeouts;
+  streamCtx->logCb = d->gatedLog(gate);
+  streamCtx->streamsCb = [this, gate](
       std::vector<std::unique_ptr<StreamChunk>> streams) {
-    d->streamDispatcher->insert(std::move(streams));
+    std::lock_guard<std::mutex> lock(gate->mutex);
+    if (gate->open)
+      d->streamDispatcher->insert(std::move(streams));
   };
-  streamCtx->vpLayersCb = [this](std::vector<std::unique_ptr<Layer>> layers) {
+  // Producers may block on a full dispatcher, so they take their own
+  // reference and release the gate before analyzing.
+  streamCtx->vpLayersCb = [this, gate](
+      std::vector<std::unique_ptr<Layer>> layers) {
+    std::shared_ptr<PacketDispatcher> dispatcher;
+    {
+      std::lock_guard<std::mutex> lock(gate->mutex);
+      if (!gate->open)
+        return;
+      dispatcher = d->packetDispatcher;
+    }
     for (auto &layer : layers) {
-      d->packetDispatcher->analyze(
+      dispatcher->analyze(
           std::unique_ptr<Packet>(new Packet(std::move(layer))));
     }
   };
   d->streamDispatcher.reset(new StreamDispatcher(streamCtx));
 
   auto pcapCtx = std::make_shared<Pcap::Context>();
-  pcapCtx->logCb = std::bind(&Private::log, std::ref(d), std::placeholders::_1);
-  pcapCtx->packetCb = [this](std::unique_ptr<Packet> pkt) {
-    analyze(std::move(pkt));
+  pcapCtx->logCb = d->gatedLog(gate);
+  pcapCtx->packetCb = [this, gate](std::unique_ptr<Packet> pkt) {
+    std::shared_ptr<PacketDispatcher> dispatcher;
+    std::string ns;
+    {
+      std::lock_guard<std::mutex> lock(gate->mutex);
+      if (!gate->open)
+        return;
+      dispatcher = d->packetDispatcher;
+      ns = d->ns;
+    }
+    dispatch(dispatcher.get(), ns, std::move(pkt), true);
   };
   d->pcap.reset(new Pcap(pcapCtx));
 
-  std::vector<std::shared_ptr<Packet>> packets;
-  if (d->store) {
-    packets = d->store->get(1, d->store->maxSeq());
-  }
   auto storeCb = [this](uint32_t maxSeq) { uv_async_send(&d->statusCbAsync); };
-  d->store.reset(new PacketStore());
+  d->store = std::make_shared<PacketStore>();
   d->store->addHandler(storeCb);
 
-  std::vector<std::pair<std::string, std::string>> filters;
-  for (const auto &pair : d->filterThreads) {
-    filters.push_back(std::make_pair(pair.first, pair.second.ctx->filter));
-  }
-  d->filterThreads.clear();
-  for (const auto &pair : filters) {
-    filter(pair.first, pair.second);
+  std::vector<std::string> indexedAttrs;
+  if (v8pp::get_option(isolate, opt, "indexed_attrs", indexedAttrs)) {
+    d->store->setIndexedAttrs(indexedAttrs);
   }
+  bool payloadIndex = false;
+  v8pp::get_option(isolate, opt, "payload_index", payloadIndex);
+  d->store->setPayloadIndexEnabled(payloadIndex);
 
-  for (const auto &pkt : packets) {
-    if (!pkt->vpacket()) {
-      analyze(pkt->shallowClone());
-    }
+  for (const auto &pair : filters) {
+    d->filter(pair.first, pair.second);
   }
 
+  uv_queue_work(uv_default_loop(), &work->req, ResetWork::run,
+                ResetWork::done);
   uv_async_send(&d->statusCbAsync);
 }
@@ -27,6 +27,8 @@ public:
                                     uint32_t end) const;
 
   std::string ns() const;
+  // Per-dissector, per-thread profiling counters.
+  v8::Local<v8::Array> stats() const;
 
   static bool permission();
   static v8::Local<v8::Array> devices();
@@ -41,7 +43,13 @@ public:
   void start();
   void stop();
 
-  void reset(v8::Local<v8::Object> opt);
+  void reset(v8::Local<v8::Object> opt, v8::Local<v8::Function> callback);
+  void ready(v8::Local<v8::Function> callback);
+  // |callback| receives null, or an error if the dissector did not load
+  // in time.
+  void reloadDissector(const std::string &resourceName,
+                       const std::string &script, const std::string &native,
+                       v8::Local<v8::Function> callback);
 
 private:
   class Private;
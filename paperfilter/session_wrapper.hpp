@@ -4,6 +4,7 @@
 #include "session.hpp"
 #include "session_packet_wrapper.hpp"
 #include "large_buffer.hpp"
+#include "native_dissector.hpp"
 #include <nan.h>
 #include <node_buffer.h>
 
@@ -22,6 +23,7 @@ public:
     SetPrototypeMethod(tpl, "filter", filter);
     SetPrototypeMethod(tpl, "get", get);
     SetPrototypeMethod(tpl, "getFiltered", getFiltered);
+    SetPrototypeMethod(tpl, "stats", stats);
     v8::Local<v8::ObjectTemplate> otl = tpl->InstanceTemplate();
     Nan::SetAccessor(otl, Nan::New("logCallback").ToLocalChecked(), logCallback,
                      setLogCallback);
@@ -39,11 +41,15 @@ public:
     SetPrototypeMethod(tpl, "stop", stop);
     SetPrototypeMethod(tpl, "close", close);
     SetPrototypeMethod(tpl, "reset", reset);
+    SetPrototypeMethod(tpl, "ready", ready);
+    SetPrototypeMethod(tpl, "reloadDissector", reloadDissector);
     constructor().Reset(Nan::GetFunction(tpl).ToLocalChecked());
 
     v8::Local<v8::Object> func = Nan::GetFunction(tpl).ToLocalChecked();
     Nan::SetAccessor(func, Nan::New("devices").ToLocalChecked(), devices);
     Nan::SetAccessor(func, Nan::New("tmpDir").ToLocalChecked(), tmpDir);
+    Nan::SetAccessor(func, Nan::New("nativeDissectors").ToLocalChecked(),
+                     nativeDissectors);
     Nan::SetAccessor(func, Nan::New("permission").ToLocalChecked(), permission);
     Nan::Set(target, Nan::New("Session").ToLocalChecked(), func);
   }
@@ -123,6 +129,13 @@ public:
     }
   }
 
+  static NAN_METHOD(stats) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    info.GetReturnValue().Set(wrapper->session->stats());
+  }
+
   static NAN_METHOD(getFiltered) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -160,6 +173,12 @@ public:
     info.GetReturnValue().Set(v8pp::to_v8(isolate, LargeBuffer::tmpDir()));
   }
 
+  static NAN_GETTER(nativeDissectors) {
+    v8::Isolate *isolate = v8::Isolate::GetCurrent();
+    info.GetReturnValue().Set(
+        v8pp::to_v8(isolate, NativeDissector::names()));
+  }
+
   static NAN_GETTER(networkInterface) {
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session)
@@ -241,7 +260,42 @@ public:
     SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
     if (!wrapper->session || !info[0]->IsObject())
       return;
-    wrapper->session->reset(info[0].As<v8::Object>());
+    v8::Local<v8::Function> callback;
+    if (info[1]->IsFunction())
+      callback = info[1].As<v8::Function>();
+    wrapper->session->reset(info[0].As<v8::Object>(), callback);
+  }
+
+  static NAN_METHOD(ready) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session || !info[0]->IsFunction())
+      return;
+    wrapper->session->ready(info[0].As<v8::Function>());
+  }
+
+  static NAN_METHOD(reloadDissector) {
+    SessionWrapper *wrapper = ObjectWrap::Unwrap<SessionWrapper>(info.Holder());
+    if (!wrapper->session)
+      return;
+    const auto &resourceName = Nan::Utf8String(info[0]);
+    std::string script;
+    if (node::Buffer::HasInstance(info[1])) {
+      script.assign(node::Buffer::Data(info[1]),
+                    node::Buffer::Length(info[1]));
+    } else if (info[1]->IsString()) {
+      script = *Nan::Utf8String(info[1]);
+    }
+    std::string native;
+    if (info[2]->IsString()) {
+      native = *Nan::Utf8String(info[2]);
+    }
+    v8::Local<v8::Function> callback;
+    if (info[3]->IsFunction())
+      callback = info[3].As<v8::Function>();
+    if (*resourceName) {
+      wrapper->session->reloadDissector(*resourceName, script, native,
+                                        callback);
+    }
   }
 
   static inline Nan::Persistent<v8::Function> &constructor() {
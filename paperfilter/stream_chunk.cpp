@@ -2,8 +2,8 @@
 #include "buffer.hpp"
 #include "item_value.hpp"
 #include "layer.hpp"
+#include "option_keys.hpp"
 #include <v8pp/class.hpp>
-#include <v8pp/object.hpp>
 
 using namespace v8;
 
@@ -19,18 +19,18 @@ public:
 StreamChunk::StreamChunk(v8::Local<v8::Object> obj)
     : d(std::make_shared<Private>()) {
   v8::Isolate *isolate = v8::Isolate::GetCurrent();
-  v8pp::get_option(isolate, obj, "namespace", d->ns);
-  v8pp::get_option(isolate, obj, "id", d->id);
+  OptionKeys::getOption(isolate, obj, OptionKeys::NAMESPACE, d->ns);
+  OptionKeys::getOption(isolate, obj, OptionKeys::ID, d->id);
 
   v8::Local<v8::Object> layerObj;
-  if (v8pp::get_option(isolate, obj, "layer", layerObj)) {
+  if (OptionKeys::getOption(isolate, obj, OptionKeys::LAYER, layerObj)) {
     if (Layer *layer = v8pp::class_<Layer>::unwrap_object(isolate, layerObj)) {
       d->layer = std::make_shared<Layer>(*layer);
     }
   }
 
   v8::Local<v8::Object> attrs;
-  if (v8pp::get_option(isolate, obj, "attrs", attrs)) {
+  if (OptionKeys::getOption(isolate, obj, OptionKeys::ATTRS, attrs)) {
     v8::Local<v8::Array> keys = attrs->GetPropertyNames();
     for (uint32_t i = 0; i < keys->Length(); ++i) {
       v8::Local<v8::Value> key = keys->Get(i);
@@ -42,6 +42,12 @@ StreamChunk::StreamChunk(v8::Local<v8::Object> obj)
   }
 }
 
+StreamChunk::StreamChunk(const std::string &ns, const std::string &id)
+    : d(std::make_shared<Private>()) {
+  d->ns = ns;
+  d->id = id;
+}
+
 StreamChunk::StreamChunk(const StreamChunk &stream) : d(stream.d) {}
 
 StreamChunk::~StreamChunk() {}
@@ -69,6 +75,10 @@ void StreamChunk::setAttr(const std::string &name, v8::Local<v8::Value> obj) {
   }
 }
 
+void StreamChunk::setAttr(const std::string &name, const ItemValue &value) {
+  d->attrs.emplace(name, value);
+}
+
 std::unordered_map<std::string, ItemValue> StreamChunk::attrs() const {
   return d->attrs;
 }
@@ -21,6 +21,7 @@ public:
 
 public:
   std::shared_ptr<Context> ctx;
+  std::shared_ptr<StreamDissectorThread::Context> dissCtx;
   std::mutex mutex;
   std::vector<std::unique_ptr<StreamDissectorThread>> dissectorThreads;
   std::map<uint32_t, std::vector<std::unique_ptr<StreamChunk>>> streamChunks;
@@ -29,15 +30,19 @@ public:
 };
 
 StreamDispatcher::Private::Private(const std::shared_ptr<Context> &ctx)
-    : ctx(ctx) {
+    : ctx(ctx),
+      dissCtx(std::make_shared<StreamDissectorThread::Context>()) {
 
-  auto dissCtx = std::make_shared<StreamDissectorThread::Context>();
   dissCtx->vpLayersCb = ctx->vpLayersCb;
   dissCtx->streamsCb = ctx->streamsCb;
   dissCtx->logCb = ctx->logCb;
   dissCtx->dissectors = ctx->dissectors;
+  dissCtx->watchdog =
+      ctx->watchdog ? ctx->watchdog : std::make_shared<Watchdog>(0);
+  dissCtx->maxTimeouts = ctx->maxTimeouts;
+  dissCtx->counters.resize(ctx->threads);
   for (int i = 0; i < ctx->threads; ++i) {
-    dissectorThreads.emplace_back(new StreamDissectorThread(dissCtx));
+    dissectorThreads.emplace_back(new StreamDissectorThread(dissCtx, i));
   }
 }
 
@@ -94,3 +99,15 @@ void StreamDispatcher::insert(
     }
   }
 }
+
+std::vector<DissectorStats> StreamDispatcher::stats() const {
+  StreamDissectorThread::Context &ctx = *d->dissCtx;
+  std::vector<DissectorStats> list;
+  std::lock_guard<std::mutex> lock(ctx.statsMutex);
+  for (size_t i = 0; i < ctx.counters.size(); ++i) {
+    for (const auto &pair : ctx.counters[i]) {
+      list.emplace_back(pair.first, i, *pair.second);
+    }
+  }
+  return list;
+}
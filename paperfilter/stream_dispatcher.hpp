@@ -2,6 +2,8 @@
 #define STREAM_DISPATCHER_HPP
 
 #include "dissector.hpp"
+#include "dissector_stats.hpp"
+#include "watchdog.hpp"
 #include <functional>
 #include <memory>
 #include <vector>
@@ -18,6 +20,8 @@ public:
     std::function<void(const LogMessage &)> logCb;
     std::function<void(std::vector<std::unique_ptr<StreamChunk>>)> streamsCb;
     std::function<void(std::vector<std::unique_ptr<Layer>>)> vpLayersCb;
+    std::shared_ptr<Watchdog> watchdog;
+    int maxTimeouts = 0;
   };
 
 public:
@@ -28,6 +32,8 @@ public:
   void insert(uint32_t seq,
               std::vector<std::unique_ptr<StreamChunk>> streamChunks);
   void insert(std::vector<std::unique_ptr<StreamChunk>> streamChunks);
+  // One entry per dissector and thread.
+  std::vector<DissectorStats> stats() const;
 
 private:
   class Private;
@@ -1,10 +1,13 @@
 #include "stream_dissector_thread.hpp"
 #include "log_message.hpp"
+#include "code_cache.hpp"
 #include "layer.hpp"
+#include "namespace_table.hpp"
 #include "packet.hpp"
 #include "paper_context.hpp"
 #include "stream_chunk.hpp"
 #include "console.hpp"
+#include <chrono>
 #include <condition_variable>
 #include <cstdlib>
 #include <mutex>
@@ -29,22 +32,38 @@ public:
   virtual void Free(void *data, size_t) { free(data); }
 };
 
+uint64_t nsecSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
 struct DissectorFunc {
-  std::vector<std::string> namespaces;
-  std::vector<std::regex> regexNamespaces;
+  std::string resourceName;
+  DissectorNamespaces namespaces;
   v8::UniquePersistent<v8::Function> func;
+  std::shared_ptr<DissectorCounters> counters;
+  std::shared_ptr<DissectorHealth> health;
+};
+
+// A dissector instance for one stream.
+struct Instance {
+  const DissectorFunc *diss;
+  v8::UniquePersistent<v8::Object> obj;
 };
 }
 
 class StreamDissectorThread::Private {
 public:
-  Private(const std::shared_ptr<Context> &ctx);
+  Private(const std::shared_ptr<Context> &ctx, size_t index);
   ~Private();
-  const std::vector<const DissectorFunc *> &findDessector(
-      const std::string &ns,
-      const std::unordered_map<std::string, DissectorFunc> &dissectors,
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-          *nsMap);
+  std::shared_ptr<DissectorCounters> counters(const std::string &name);
+  std::shared_ptr<DissectorHealth> health(const std::string &name);
+  void scriptError(const DissectorFunc &diss, const v8::TryCatch &try_catch,
+                   const StreamChunk &chunk);
+  void timedOut(const DissectorFunc &diss, const StreamChunk &chunk);
+  std::shared_ptr<const NamespaceTable>
+  namespaceTable(const std::unordered_map<std::string, DissectorFunc> &funcs);
 
 public:
   std::thread thread;
@@ -54,10 +73,13 @@ public:
   bool closed = false;
 
   std::shared_ptr<Context> ctx;
+  size_t index;
+  std::shared_ptr<Watchdog::Slot> slot;
 };
 
-StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
-    : ctx(ctx) {
+StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx,
+                                        size_t index)
+    : ctx(ctx), index(index) {
 
   thread = std::thread([this]() {
     Context &ctx = *this->ctx;
@@ -76,6 +98,7 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
       v8::Context::Scope context_scope(context);
       v8::TryCatch try_catch;
       PaperContext::init(isolate);
+      slot = ctx.watchdog->watch(isolate);
 
       v8::Local<v8::Object> console = v8pp::class_<Console>::create_object(
           isolate, ctx.logCb, "stream_dissector");
@@ -83,7 +106,6 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
           v8pp::to_v8(isolate, "console"), console);
 
       std::unordered_map<std::string, DissectorFunc> dissectors;
-      std::unordered_map<std::string, std::vector<const DissectorFunc *>> nsMap;
 
       for (const Dissector &diss : ctx.dissectors) {
         v8::Local<v8::Object> moduleObj = v8::Object::New(isolate);
@@ -91,9 +113,11 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
                                moduleObj);
 
         v8::Local<v8::Function> func;
-        Nan::MaybeLocal<Nan::BoundScript> script = Nan::CompileScript(
-            v8pp::to_v8(isolate, "(function(){" + diss.script + "})()"),
-            v8::ScriptOrigin(v8pp::to_v8(isolate, diss.resourceName)));
+        DissectorNamespaces namespaces;
+        slot->arm();
+        Nan::MaybeLocal<Nan::BoundScript> script =
+            CodeCache::compile(isolate, "(function(){" + diss.script + "})()",
+                               diss.resourceName);
         if (!script.IsEmpty()) {
           Nan::RunScript(script.ToLocalChecked());
           v8::Local<v8::Value> result =
@@ -101,39 +125,42 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
 
           if (!result.IsEmpty() && result->IsFunction()) {
             func = result.As<v8::Function>();
+            namespaces = DissectorNamespaces(func);
           }
         }
-        if (func.IsEmpty()) {
+        if (slot->disarm()) {
+          if (ctx.logCb) {
+            LogMessage msg;
+            msg.level = LogMessage::LEVEL_ERROR;
+            msg.message = "Timed out after " +
+                          std::to_string(ctx.watchdog->timeout()) +
+                          " ms while loading";
+            msg.domain = "stream_dissector";
+            msg.resourceName = diss.resourceName;
+            ctx.logCb(msg);
+          }
+        } else if (func.IsEmpty()) {
           if (ctx.logCb) {
             ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
                                               "stream_dissector"));
           }
         } else {
-          v8::Local<v8::Array> namespaces;
-          std::vector<std::string> stringNamespaces;
-          std::vector<std::regex> regexNamespaces;
-
-          if (v8pp::get_option(isolate, func, "namespaces", namespaces)) {
-            for (uint32_t i = 0; i < namespaces->Length(); ++i) {
-              v8::Local<v8::Value> ns = namespaces->Get(i);
-              if (ns->IsString()) {
-                stringNamespaces.push_back(
-                    v8pp::from_v8<std::string>(isolate, ns, ""));
-              } else if (ns->IsRegExp()) {
-                regexNamespaces.push_back(std::regex(v8pp::from_v8<std::string>(
-                    isolate, ns.As<v8::RegExp>()->GetSource(), "")));
-              }
-            }
-          }
-
           dissectors[diss.resourceName] = {
-              stringNamespaces, regexNamespaces,
-              v8::UniquePersistent<v8::Function>(isolate, func)};
+              diss.resourceName, namespaces,
+              v8::UniquePersistent<v8::Function>(isolate, func),
+              counters(diss.resourceName), health(diss.resourceName)};
         }
       }
 
-      std::unordered_map<
-          std::string, std::vector<v8::UniquePersistent<v8::Object>>> instances;
+      const std::shared_ptr<const NamespaceTable> &table =
+          namespaceTable(dissectors);
+      std::vector<const DissectorFunc *> funcs;
+      for (const std::string &name : table->names()) {
+        const auto it = dissectors.find(name);
+        funcs.push_back(it != dissectors.end() ? &it->second : nullptr);
+      }
+
+      std::unordered_map<std::string, std::vector<Instance>> instances;
 
       while (true) {
         std::unique_lock<std::mutex> lock(mutex);
@@ -148,25 +175,31 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
         const std::string &key = chunk->ns() + "@" + chunk->id();
         auto it = instances.find(key);
         if (it == instances.end()) {
-          std::vector<v8::UniquePersistent<v8::Object>> objs;
-          for (const DissectorFunc *diss :
-               findDessector(chunk->ns(), dissectors, &nsMap)) {
+          std::vector<Instance> objs;
+          for (uint32_t index : table->find(chunk->ns())) {
+            const DissectorFunc *diss = funcs[index];
+            if (!diss || diss->health->disabled)
+              continue;
             v8::Local<v8::Function> func =
                 v8::Local<v8::Function>::New(isolate, diss->func);
+            const auto start = std::chrono::steady_clock::now();
+            slot->arm();
             v8::Local<v8::Object> obj = func->NewInstance();
             if (obj.IsEmpty()) {
-              if (ctx.logCb) {
-                ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
-                                                  "stream_dissector"));
-              }
+              diss->counters->record(nsecSince(start), true, 0, 0);
+              scriptError(*diss, try_catch, *chunk);
+            } else if (slot->disarm()) {
+              diss->counters->record(nsecSince(start), true, 0, 0);
+              timedOut(*diss, *chunk);
             } else {
-              objs.push_back(v8::UniquePersistent<v8::Object>(isolate, obj));
+              objs.push_back(
+                  {diss, v8::UniquePersistent<v8::Object>(isolate, obj)});
             }
           }
           it = instances.insert(std::make_pair(key, std::move(objs))).first;
         }
 
-        const std::vector<v8::UniquePersistent<v8::Object>> &objs = it->second;
+        const std::vector<Instance> &objs = it->second;
         std::shared_ptr<Layer> layer = chunk->layer();
         std::shared_ptr<Packet> packet = layer->packet();
         v8::Local<v8::Object> layerObj =
@@ -180,31 +213,46 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
         std::vector<std::unique_ptr<Layer>> vpLayers;
         std::vector<std::unique_ptr<StreamChunk>> streams;
 
-        for (const auto &unique : objs) {
+        for (const Instance &instance : objs) {
+          if (instance.diss->health->disabled)
+            continue;
+          const auto start = std::chrono::steady_clock::now();
+          const size_t layerCount = vpLayers.size();
+          const size_t streamCount = streams.size();
+          bool failed = false;
           v8::Local<v8::Object> obj =
-              v8::Local<v8::Object>::New(isolate, unique);
+              v8::Local<v8::Object>::New(isolate, instance.obj);
+          slot->arm();
           v8::Local<v8::Value> analyze =
               obj->Get(v8pp::to_v8(isolate, "analyze"));
+          v8::Local<v8::Value> result;
           if (!analyze.IsEmpty() && analyze->IsFunction()) {
             v8::Local<v8::Function> analyzeFunc = analyze.As<v8::Function>();
             v8::Handle<v8::Value> args[3] = {packetObj, layerObj, chunkObj};
-            v8::Local<v8::Value> result = analyzeFunc->Call(obj, 3, args);
-
+            result = analyzeFunc->Call(obj, 3, args);
             if (result.IsEmpty()) {
-              if (ctx.logCb) {
-                ctx.logCb(LogMessage::fromMessage(try_catch.Message(),
-                                                  "stream_dissector"));
-              }
-            } else if (result->IsArray()) {
+              failed = true;
+              scriptError(*instance.diss, try_catch, *chunk);
+            }
+          }
+          // Whatever a terminated call returned is dropped.
+          if (slot->disarm()) {
+            failed = true;
+            timedOut(*instance.diss, *chunk);
+          } else if (!result.IsEmpty()) {
+            if (result->IsArray()) {
               v8::Local<v8::Array> array = result.As<v8::Array>();
               for (uint32_t i = 0; i < array->Length(); ++i) {
-                if (Layer *vpLayer = v8pp::class_<Layer>::unwrap_object(
-                        isolate, array->Get(i))) {
+                v8::Local<v8::Value> value = array->Get(i);
+                if (value.IsEmpty())
+                  break;
+                if (Layer *vpLayer =
+                        v8pp::class_<Layer>::unwrap_object(isolate, value)) {
                   vpLayers.push_back(
                       std::unique_ptr<Layer>(new Layer(*vpLayer)));
                 } else if (StreamChunk *stream =
                                v8pp::class_<StreamChunk>::unwrap_object(
-                                   isolate, array->Get(i))) {
+                                   isolate, value)) {
 
                   auto newChunk =
                       std::unique_ptr<StreamChunk>(new StreamChunk(*stream));
@@ -229,6 +277,9 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
               streams.push_back(std::move(newChunk));
             }
           }
+          instance.diss->counters->record(
+              nsecSince(start), failed, vpLayers.size() - layerCount,
+              streams.size() - streamCount);
         }
 
         v8pp::class_<Packet>::unreference_external(isolate, packet.get());
@@ -248,6 +299,7 @@ StreamDissectorThread::Private::Private(const std::shared_ptr<Context> &ctx)
       }
     }
 
+    slot.reset();
     isolate->Dispose();
   });
 }
@@ -262,43 +314,83 @@ StreamDissectorThread::Private::~Private() {
     thread.join();
 }
 
-const std::vector<const DissectorFunc *> &
-StreamDissectorThread::Private::findDessector(
-    const std::string &ns,
-    const std::unordered_map<std::string, DissectorFunc> &dissectors,
-    std::unordered_map<std::string, std::vector<const DissectorFunc *>>
-        *nsMap) {
-  static const std::vector<DissectorFunc *> null;
-
-  auto it = nsMap->find(ns);
-  if (it != nsMap->end())
-    return it->second;
-
-  std::vector<const DissectorFunc *> &funcs = (*nsMap)[ns];
-  for (const auto &pair : dissectors) {
-    const auto &diss = pair.second;
-    for (const std::string &dissNs : diss.namespaces) {
-      if (dissNs == ns) {
-        funcs.push_back(&diss);
-        break;
-      }
-    }
-    if (funcs.empty()) {
-      for (const std::regex &regex : diss.regexNamespaces) {
-        if (std::regex_match(ns, regex)) {
-          funcs.push_back(&diss);
-          break;
-        }
-      }
-    }
+std::shared_ptr<DissectorCounters>
+StreamDissectorThread::Private::counters(const std::string &name) {
+  std::lock_guard<std::mutex> lock(ctx->statsMutex);
+  std::shared_ptr<DissectorCounters> &counters = ctx->counters[index][name];
+  if (!counters) {
+    counters = std::make_shared<DissectorCounters>();
   }
+  return counters;
+}
+
+// Stream dissectors only change on reset, so one entry per resourceName
+// lasts as long as the context.
+std::shared_ptr<DissectorHealth>
+StreamDissectorThread::Private::health(const std::string &name) {
+  std::lock_guard<std::mutex> lock(ctx->statsMutex);
+  std::shared_ptr<DissectorHealth> &health = ctx->health[name];
+  if (!health) {
+    health = std::make_shared<DissectorHealth>();
+  }
+  return health;
+}
 
-  return funcs;
+// A terminated call leaves no message behind, so it must be disarmed before
+// the exception is logged.
+void StreamDissectorThread::Private::scriptError(
+    const DissectorFunc &diss, const v8::TryCatch &try_catch,
+    const StreamChunk &chunk) {
+  if (slot->disarm()) {
+    timedOut(diss, chunk);
+  } else if (ctx->logCb) {
+    ctx->logCb(
+        LogMessage::fromMessage(try_catch.Message(), "stream_dissector"));
+  }
+}
+
+// Disables the dissector once it has timed out too often.
+void StreamDissectorThread::Private::timedOut(const DissectorFunc &diss,
+                                              const StreamChunk &chunk) {
+  const int timeouts = ++diss.health->timeouts;
+  const bool disable = ctx->maxTimeouts > 0 &&
+                       timeouts >= ctx->maxTimeouts &&
+                       !diss.health->disabled.exchange(true);
+  if (!ctx->logCb)
+    return;
+
+  LogMessage msg;
+  msg.level = LogMessage::LEVEL_ERROR;
+  msg.message = "Timed out after " +
+                std::to_string(ctx->watchdog->timeout()) + " ms on stream " +
+                chunk.ns() + "@" + chunk.id();
+  msg.domain = "stream_dissector";
+  msg.resourceName = diss.resourceName;
+  ctx->logCb(msg);
+  if (disable) {
+    msg.level = LogMessage::LEVEL_WARN;
+    msg.message = "Disabled after " + std::to_string(timeouts) + " timeouts";
+    ctx->logCb(msg);
+  }
+}
+
+std::shared_ptr<const NamespaceTable>
+StreamDissectorThread::Private::namespaceTable(
+    const std::unordered_map<std::string, DissectorFunc> &funcs) {
+  std::lock_guard<std::mutex> lock(ctx->tableMutex);
+  if (!ctx->table) {
+    std::vector<std::pair<std::string, DissectorNamespaces>> dissectors;
+    for (const auto &pair : funcs) {
+      dissectors.emplace_back(pair.first, pair.second.namespaces);
+    }
+    ctx->table = std::make_shared<const NamespaceTable>(dissectors);
+  }
+  return ctx->table;
 }
 
 StreamDissectorThread::StreamDissectorThread(
-    const std::shared_ptr<Context> &ctx)
-    : d(new Private(ctx)) {}
+    const std::shared_ptr<Context> &ctx, size_t index)
+    : d(new Private(ctx, index)) {}
 
 StreamDissectorThread::~StreamDissectorThread() {}
 
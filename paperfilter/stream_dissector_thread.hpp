@@ -2,13 +2,18 @@
 #define STREAM_DISSECTOR_THREAD_HPP
 
 #include "dissector.hpp"
+#include "dissector_stats.hpp"
+#include "watchdog.hpp"
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class StreamChunk;
 class Layer;
+class NamespaceTable;
 struct LogMessage;
 
 class StreamDissectorThread {
@@ -18,10 +23,26 @@ public:
     std::function<void(const LogMessage &)> logCb;
     std::function<void(std::vector<std::unique_ptr<StreamChunk>>)> streamsCb;
     std::function<void(std::vector<std::unique_ptr<Layer>>)> vpLayersCb;
+    std::shared_ptr<Watchdog> watchdog;
+    int maxTimeouts = 0;
+
+    // Built by the first thread that loads the dissectors.
+    std::mutex tableMutex;
+    std::shared_ptr<const NamespaceTable> table;
+
+    // Profiling counters per thread, keyed by resourceName, as in
+    // DissectorSharedContext.
+    std::mutex statsMutex;
+    std::vector<
+        std::unordered_map<std::string, std::shared_ptr<DissectorCounters>>>
+        counters;
+    // Timeouts per resourceName across threads; also guarded by
+    // |statsMutex|.
+    std::unordered_map<std::string, std::shared_ptr<DissectorHealth>> health;
   };
 
 public:
-  StreamDissectorThread(const std::shared_ptr<Context> &ctx);
+  StreamDissectorThread(const std::shared_ptr<Context> &ctx, size_t index);
   ~StreamDissectorThread();
   StreamDissectorThread(const StreamDissectorThread &) = delete;
   StreamDissectorThread &operator=(const StreamDissectorThread &) = delete;
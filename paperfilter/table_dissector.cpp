@@ -0,0 +1,393 @@
+#include "table_dissector.hpp"
+#include "buffer.hpp"
+#include "byte_ops.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "native_values.hpp"
+#include <algorithm>
+#include <cctype>
+#include <json11.hpp>
+#include <stdexcept>
+
+using namespace NativeValues;
+
+namespace {
+enum FieldType { UINT8, UINT16, UINT32, BYTES, MAC, IPV4, IPV6 };
+
+struct Field {
+  std::string id;
+  std::string name;
+  std::string range;
+  FieldType type = UINT8;
+  size_t offset = 0;
+  size_t length = 1;
+  bool little = false;
+  uint32_t mask = 0xffffffff;
+  uint32_t shift = 0;
+  int enumIndex = -1;
+  int flagsIndex = -1;
+  bool attr = true;
+  bool displayed = false;
+};
+
+struct Segment {
+  std::string literal;
+  int field = -1;
+  bool upper = false;
+};
+
+[[noreturn]] void fail(const std::string &message) {
+  throw std::invalid_argument("Invalid dissector table: " + message);
+}
+
+uint32_t unsignedValue(const json11::Json &json, const std::string &what) {
+  const double num = json.number_value();
+  if (!json.is_number() || num < 0 || num > 0xffffffff ||
+      num != static_cast<uint32_t>(num))
+    fail(what + " must be an unsigned integer");
+  return static_cast<uint32_t>(num);
+}
+
+const std::string &stringValue(const json11::Json &json,
+                               const std::string &what) {
+  if (!json.is_string())
+    fail(what + " must be a string");
+  return json.string_value();
+}
+
+uint32_t parseKey(const std::string &key) {
+  size_t pos = 0;
+  unsigned long value = 0;
+  try {
+    value = std::stoul(key, &pos, 0);
+  } catch (const std::exception &) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != key.size() || value > 0xffffffff)
+    fail("enum key " + key + " is not a number");
+  return static_cast<uint32_t>(value);
+}
+
+std::string upper(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(),
+                 [](unsigned char c) { return std::toupper(c); });
+  return str;
+}
+}
+
+class TableDissector::Private {
+public:
+  explicit Private(const std::string &source);
+  int fieldIndex(const std::string &id) const;
+  std::vector<Segment> compile(const std::string &tmpl);
+  ItemValue value(const Field &field, const Buffer &payload, uint32_t *num,
+                  std::string *display) const;
+
+public:
+  DissectorNamespaces namespaces;
+  std::string ns;
+  std::string name;
+  std::string id;
+  std::vector<EnumTable> enums;
+  std::vector<FlagTable> flags;
+  std::vector<Field> fields;
+  std::vector<Segment> summary;
+  int nextField = -1;
+  std::string nextNs;
+  bool hasPayload = false;
+  size_t payloadOffset = 0;
+};
+
+TableDissector::Private::Private(const std::string &source) {
+  std::string err;
+  const json11::Json spec = json11::Json::parse(source, err);
+  if (!err.empty())
+    fail(err);
+  if (!spec.is_object())
+    fail("root must be an object");
+
+  std::vector<std::string> names;
+  std::vector<std::string> regexSources;
+  for (const json11::Json &item : spec["namespaces"].array_items()) {
+    const std::string &str = stringValue(item, "namespace");
+    if (str.size() >= 2 && str.front() == '/' && str.back() == '/') {
+      regexSources.push_back(str.substr(1, str.size() - 2));
+    } else {
+      names.push_back(str);
+    }
+  }
+  if (names.empty() && regexSources.empty())
+    fail("namespaces must not be empty");
+  try {
+    namespaces = DissectorNamespaces(names, regexSources);
+  } catch (const std::regex_error &e) {
+    fail(std::string("bad namespace pattern: ") + e.what());
+  }
+
+  name = stringValue(spec["name"], "name");
+  id = stringValue(spec["id"], "id");
+  if (!spec["namespace"].is_null())
+    ns = stringValue(spec["namespace"], "namespace");
+
+  std::unordered_map<std::string, int> enumNames;
+  for (const auto &pair : spec["enums"].object_items()) {
+    EnumTable table;
+    for (const auto &entry : pair.second.object_items()) {
+      table[parseKey(entry.first)] = stringValue(entry.second, "enum name");
+    }
+    enumNames[pair.first] = enums.size();
+    enums.push_back(std::move(table));
+  }
+
+  std::unordered_map<std::string, int> flagNames;
+  for (const auto &pair : spec["flags"].object_items()) {
+    FlagTable table;
+    for (const json11::Json &entry : pair.second.array_items()) {
+      const auto &items = entry.array_items();
+      if (items.size() != 2)
+        fail("flag " + pair.first + " must be [name, mask] pairs");
+      table.emplace_back(stringValue(items[0], "flag name"),
+                         unsignedValue(items[1], "flag mask"));
+    }
+    flagNames[pair.first] = flags.size();
+    flags.push_back(std::move(table));
+  }
+
+  for (const json11::Json &item : spec["fields"].array_items()) {
+    Field field;
+    field.id = stringValue(item["id"], "field id");
+    field.name = stringValue(item["name"], "field name");
+    field.offset = unsignedValue(item["offset"], field.id + ".offset");
+    if (fieldIndex(field.id) >= 0)
+      fail("duplicate field " + field.id);
+
+    const std::string &type = stringValue(item["type"], field.id + ".type");
+    const std::unordered_map<std::string, std::pair<FieldType, size_t>>
+        types = {{"uint8", {UINT8, 1}}, {"uint16", {UINT16, 2}},
+                 {"uint32", {UINT32, 4}}, {"bytes", {BYTES, 0}},
+                 {"mac", {MAC, 6}},       {"ipv4", {IPV4, 4}},
+                 {"ipv6", {IPV6, 16}}};
+    const auto it = types.find(type);
+    if (it == types.end())
+      fail(field.id + " has unknown type " + type);
+    field.type = it->second.first;
+    field.length = it->second.second;
+    if (field.type == BYTES)
+      field.length = unsignedValue(item["length"], field.id + ".length");
+    field.range = range(field.offset, field.offset + field.length);
+
+    const bool integer = field.type <= UINT32;
+    if (!item["endian"].is_null()) {
+      const std::string &endian = stringValue(item["endian"], "endian");
+      if (!integer || (endian != "little" && endian != "big"))
+        fail(field.id + " has invalid endian");
+      field.little = (endian == "little");
+    }
+    if (!item["shift"].is_null())
+      field.shift = unsignedValue(item["shift"], field.id + ".shift");
+    if (!item["mask"].is_null())
+      field.mask = unsignedValue(item["mask"], field.id + ".mask");
+    if (field.shift >= 32 || (!integer && (field.shift || ~field.mask)))
+      fail(field.id + " has invalid shift or mask");
+
+    if (!item["enum"].is_null()) {
+      const auto en = enumNames.find(stringValue(item["enum"], "enum"));
+      if (!integer || en == enumNames.end())
+        fail(field.id + " has unknown enum");
+      field.enumIndex = en->second;
+    }
+    if (!item["flags"].is_null()) {
+      const auto fl = flagNames.find(stringValue(item["flags"], "flags"));
+      if (!integer || fl == flagNames.end() || field.enumIndex >= 0)
+        fail(field.id + " has unknown flags");
+      field.flagsIndex = fl->second;
+    }
+    if (!item["attr"].is_null())
+      field.attr = item["attr"].bool_value();
+    fields.push_back(std::move(field));
+  }
+
+  if (!spec["summary"].is_null())
+    summary = compile(stringValue(spec["summary"], "summary"));
+
+  const json11::Json &next = spec["next"];
+  if (!next.is_null()) {
+    nextField = fieldIndex(stringValue(next["field"], "next.field"));
+    if (nextField < 0 || fields[nextField].enumIndex < 0)
+      fail("next.field must name an enum field");
+    nextNs = stringValue(next["namespace"], "next.namespace");
+  }
+
+  if (!spec["payload"].is_null()) {
+    hasPayload = true;
+    payloadOffset = unsignedValue(spec["payload"], "payload");
+  }
+}
+
+int TableDissector::Private::fieldIndex(const std::string &id) const {
+  for (size_t i = 0; i < fields.size(); ++i) {
+    if (fields[i].id == id)
+      return i;
+  }
+  return -1;
+}
+
+// Splits "{id}" and "{id|upper}" references out of a summary template.
+std::vector<Segment>
+TableDissector::Private::compile(const std::string &tmpl) {
+  std::vector<Segment> segments;
+  size_t pos = 0;
+  while (pos < tmpl.size()) {
+    const size_t open = tmpl.find('{', pos);
+    Segment literal;
+    literal.literal = tmpl.substr(pos, open - pos);
+    if (!literal.literal.empty())
+      segments.push_back(literal);
+    if (open == std::string::npos)
+      break;
+
+    const size_t close = tmpl.find('}', open);
+    if (close == std::string::npos)
+      fail("unterminated reference in summary");
+    std::string ref = tmpl.substr(open + 1, close - open - 1);
+    Segment segment;
+    const size_t bar = ref.find('|');
+    if (bar != std::string::npos) {
+      if (ref.substr(bar + 1) != "upper")
+        fail("unknown filter in summary: " + ref);
+      segment.upper = true;
+      ref.resize(bar);
+    }
+    segment.field = fieldIndex(ref);
+    if (segment.field < 0)
+      fail("unknown field in summary: " + ref);
+    fields[segment.field].displayed = true;
+    segments.push_back(segment);
+    pos = close + 1;
+  }
+  return segments;
+}
+
+ItemValue TableDissector::Private::value(const Field &field,
+                                         const Buffer &payload, uint32_t *num,
+                                         std::string *display) const {
+  if (field.offset + field.length > payload.length())
+    throw std::out_of_range(outOfRange);
+
+  switch (field.type) {
+  case UINT8:
+    *num = readUInt8(payload, field.offset);
+    break;
+  case UINT16:
+    *num = readUInt16BE(payload, field.offset);
+    if (field.little)
+      *num = ((*num & 0xff) << 8) | (*num >> 8);
+    break;
+  case UINT32:
+    *num = readUInt32BE(payload, field.offset);
+    if (field.little)
+      *num = ((*num & 0xff) << 24) | ((*num & 0xff00) << 8) |
+             ((*num >> 8) & 0xff00) | (*num >> 24);
+    break;
+  case BYTES: {
+    std::unique_ptr<Buffer> buf =
+        slice(payload, field.offset, field.offset + field.length);
+    if (field.displayed) {
+      display->resize(buf->length() * 2);
+      ByteOps::hexEncode(buf->data(), buf->length(), &(*display)[0]);
+    }
+    return ItemValue(std::move(buf));
+  }
+  default: {
+    static const char *const types[] = {"dripcap/mac", "dripcap/ipv4/addr",
+                                        "dripcap/ipv6/addr"};
+    ItemValue addr(slice(payload, field.offset, field.offset + field.length),
+                   types[field.type - MAC]);
+    if (field.displayed)
+      *display = formatAddress(addr);
+    return addr;
+  }
+  }
+
+  *num = (*num >> field.shift) & field.mask;
+  if (field.enumIndex >= 0) {
+    const EnumTable &table = enums[field.enumIndex];
+    if (field.displayed) {
+      const std::string *name = enumName(table, *num);
+      *display = name ? *name : "Unknown";
+    }
+    return enumValue(table, *num);
+  }
+  if (field.displayed)
+    *display = std::to_string(*num);
+  if (field.flagsIndex >= 0)
+    return flagsValue(flags[field.flagsIndex], *num);
+  return number(*num);
+}
+
+TableDissector::TableDissector(const std::string &source)
+    : d(new Private(source)) {}
+
+TableDissector::~TableDissector() {}
+
+DissectorNamespaces TableDissector::namespaces() const {
+  return d->namespaces;
+}
+
+void TableDissector::analyze(
+    const Packet &, const Layer &parentLayer,
+    std::vector<std::shared_ptr<Layer>> *layers,
+    std::vector<std::unique_ptr<StreamChunk>> *) const {
+  const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+  const std::string ns =
+      d->ns.empty()
+          ? replaceFirst(parentLayer.ns(), "<" + d->name + ">", d->name)
+          : d->ns;
+  auto layer = std::make_shared<Layer>(ns);
+  layer->setName(d->name);
+  layer->setId(d->id);
+
+  std::vector<std::string> display(d->fields.size());
+  std::vector<uint32_t> nums(d->fields.size());
+  for (size_t i = 0; i < d->fields.size(); ++i) {
+    const Field &field = d->fields[i];
+    const ItemValue value = d->value(field, *payload, &nums[i], &display[i]);
+    layer->addItem(Item(field.name, value, field.range));
+    if (field.attr) {
+      layer->setAttr(field.id, value);
+    }
+  }
+
+  if (d->nextField >= 0) {
+    const Field &field = d->fields[d->nextField];
+    const std::string *name =
+        enumName(d->enums[field.enumIndex], nums[d->nextField]);
+    if (name)
+      layer->setNs(replaceFirst(d->nextNs, "{name}", *name));
+  }
+
+  if (!d->summary.empty()) {
+    std::string summary;
+    for (const Segment &segment : d->summary) {
+      if (segment.field < 0) {
+        summary += segment.literal;
+      } else if (segment.upper) {
+        summary += upper(display[segment.field]);
+      } else {
+        summary += display[segment.field];
+      }
+    }
+    layer->setSummary(summary);
+  }
+
+  if (d->hasPayload) {
+    const std::string payloadRange = range(d->payloadOffset);
+    layer->setRange(payloadRange);
+    layer->setPayload(slice(*payload, d->payloadOffset));
+    layer->addItem(Item("Payload",
+                        ItemValue(slice(*payload, d->payloadOffset)),
+                        payloadRange));
+  }
+  layers->push_back(layer);
+}
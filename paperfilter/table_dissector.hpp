@@ -0,0 +1,45 @@
+#ifndef TABLE_DISSECTOR_HPP
+#define TABLE_DISSECTOR_HPP
+
+#include "native_dissector.hpp"
+#include <memory>
+#include <string>
+
+// A native dissector compiled from a declarative JSON field table, for
+// fixed-layout headers that do not need a script. Registered as "table";
+// the spec is the registered source:
+//
+//   {
+//     "namespaces": ["::Ethernet::<ARP>"],
+//     "name": "ARP", "id": "arp",
+//     "enums": {"op": {"0x1": "request"}},
+//     "flags": {"f": [["Reserved", 1]]},
+//     "fields": [{"id": "operation", "name": "Operation",
+//                 "type": "uint16", "offset": 6, "enum": "op"}],
+//     "summary": "[{operation|upper}]",
+//     "next": {"field": "operation", "namespace": "::Ethernet::<{name}>"},
+//     "payload": 28
+//   }
+//
+// Field types are uint8, uint16, uint32, bytes (with "length"), mac, ipv4
+// and ipv6. Integer fields also take "endian": "little", "mask", "shift",
+// "enum" and "flags"; any field takes "attr": false. A namespace in
+// slashes is a regular expression, and "namespace" defaults to the
+// parent's with "<name>" unwrapped. Throws std::invalid_argument if the
+// spec is malformed.
+class TableDissector : public NativeDissector {
+public:
+  explicit TableDissector(const std::string &source);
+  ~TableDissector();
+  DissectorNamespaces namespaces() const override;
+  void analyze(const Packet &packet, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override;
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
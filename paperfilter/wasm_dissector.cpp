@@ -0,0 +1,309 @@
+#include "wasm_dissector.hpp"
+#include "buffer.hpp"
+#include "item.hpp"
+#include "item_value.hpp"
+#include "layer.hpp"
+#include "native_values.hpp"
+#include <cstring>
+#include <stdexcept>
+#include <v8pp/convert.hpp>
+#include <v8pp/throw_ex.hpp>
+
+using namespace NativeValues;
+
+namespace {
+const char wasmMagic[] = {'\0', 'a', 's', 'm'};
+
+v8::Local<v8::Value> get(v8::Isolate *isolate, v8::Local<v8::Value> obj,
+                         const char *name) {
+  if (obj.IsEmpty() || !obj->IsObject())
+    return v8::Local<v8::Value>();
+  return obj.As<v8::Object>()->Get(v8pp::to_v8(isolate, name));
+}
+
+std::string exceptionMessage(v8::Isolate *isolate,
+                             const v8::TryCatch &try_catch) {
+  if (try_catch.Message().IsEmpty())
+    return "WebAssembly dissector failed";
+  return v8pp::from_v8<std::string>(isolate, try_catch.Message()->Get(), "");
+}
+}
+
+class WasmDissector::Private {
+public:
+  typedef void (Private::*Method)(const v8::FunctionCallbackInfo<v8::Value> &);
+
+public:
+  explicit Private(v8::Isolate *isolate);
+  template <Method method>
+  static void call(const v8::FunctionCallbackInfo<v8::Value> &args);
+  char *memory(size_t address, size_t length) const;
+  uint32_t u32(const v8::FunctionCallbackInfo<v8::Value> &args, int i) const;
+  std::string text(const v8::FunctionCallbackInfo<v8::Value> &args,
+                   int i) const;
+  Layer &layer() const;
+  void addField(const v8::FunctionCallbackInfo<v8::Value> &args,
+                const ItemValue &value, int rangeIndex);
+
+  void addNamespace(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void startLayer(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void setSummary(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void setPayload(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void addNumber(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void addString(const v8::FunctionCallbackInfo<v8::Value> &args);
+  void addBytes(const v8::FunctionCallbackInfo<v8::Value> &args);
+
+public:
+  v8::Isolate *isolate;
+  v8::UniquePersistent<v8::Object> memoryObj;
+  v8::UniquePersistent<v8::Function> input;
+  v8::UniquePersistent<v8::Function> analyze;
+  DissectorNamespaces namespaces;
+  bool initializing = false;
+
+  // Only set while analyze() is running.
+  const Buffer *payload = nullptr;
+  std::vector<std::shared_ptr<Layer>> *layers = nullptr;
+  std::shared_ptr<Layer> current;
+};
+
+WasmDissector::Private::Private(v8::Isolate *isolate) : isolate(isolate) {}
+
+// Forwards an import to |method|; C++ exceptions must not unwind through
+// wasm frames, so they are rethrown into the module as a trap.
+template <WasmDissector::Private::Method method>
+void WasmDissector::Private::call(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  Private *d = static_cast<Private *>(args.Data().As<v8::External>()->Value());
+  try {
+    (d->*method)(args);
+  } catch (const std::exception &e) {
+    args.GetReturnValue().Set(v8pp::throw_ex(d->isolate, e.what()));
+  }
+}
+
+// Linear memory may be replaced when the module grows it, so the buffer is
+// looked up on every access.
+char *WasmDissector::Private::memory(size_t address, size_t length) const {
+  v8::Local<v8::Value> buffer =
+      get(isolate, v8::Local<v8::Object>::New(isolate, memoryObj), "buffer");
+  if (buffer.IsEmpty() || !buffer->IsArrayBuffer())
+    throw std::runtime_error("module memory is not available");
+  const v8::ArrayBuffer::Contents contents =
+      buffer.As<v8::ArrayBuffer>()->GetContents();
+  if (address > contents.ByteLength() ||
+      length > contents.ByteLength() - address)
+    throw std::out_of_range(outOfRange);
+  return static_cast<char *>(contents.Data()) + address;
+}
+
+uint32_t
+WasmDissector::Private::u32(const v8::FunctionCallbackInfo<v8::Value> &args,
+                            int i) const {
+  return v8pp::from_v8<uint32_t>(isolate, args[i], 0);
+}
+
+std::string
+WasmDissector::Private::text(const v8::FunctionCallbackInfo<v8::Value> &args,
+                             int i) const {
+  const uint32_t length = u32(args, i + 1);
+  return std::string(memory(u32(args, i), length), length);
+}
+
+Layer &WasmDissector::Private::layer() const {
+  if (!current)
+    throw std::logic_error("no layer has been started");
+  return *current;
+}
+
+void WasmDissector::Private::addField(
+    const v8::FunctionCallbackInfo<v8::Value> &args, const ItemValue &value,
+    int rangeIndex) {
+  const std::string &name = text(args, 0);
+  const std::string &id = text(args, 2);
+  const uint32_t start = u32(args, rangeIndex);
+  const uint32_t end = u32(args, rangeIndex + 1);
+  layer().addItem(Item(name, value, range(start, end)));
+  if (!id.empty()) {
+    layer().setAttr(id, value);
+  }
+}
+
+void WasmDissector::Private::addNamespace(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  if (!initializing)
+    throw std::logic_error("namespaces can only be added by init()");
+  const std::string &ns = text(args, 0);
+  if (ns.size() >= 2 && ns.front() == '/' && ns.back() == '/') {
+    const std::string source = ns.substr(1, ns.size() - 2);
+    namespaces.regexNamespaces.push_back(std::regex(source));
+    namespaces.regexSources.push_back(source);
+  } else {
+    namespaces.namespaces.push_back(ns);
+  }
+}
+
+void WasmDissector::Private::startLayer(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  if (!layers)
+    throw std::logic_error("layers can only be added by analyze()");
+  current = std::make_shared<Layer>(text(args, 0));
+  current->setName(text(args, 2));
+  current->setId(text(args, 4));
+  layers->push_back(current);
+}
+
+void WasmDissector::Private::setSummary(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  layer().setSummary(text(args, 0));
+}
+
+void WasmDissector::Private::setPayload(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  const uint32_t start = u32(args, 0);
+  const int32_t end = v8pp::from_v8<int32_t>(isolate, args[1], -1);
+  if (end < 0) {
+    layer().setRange(range(start));
+    layer().setPayload(slice(*payload, start));
+  } else {
+    layer().setRange(range(start, end));
+    layer().setPayload(slice(*payload, start, end));
+  }
+}
+
+void WasmDissector::Private::addNumber(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  addField(args, number(v8pp::from_v8<double>(isolate, args[4], 0)), 5);
+}
+
+void WasmDissector::Private::addString(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  addField(args, NativeValues::text(text(args, 4)), 6);
+}
+
+void WasmDissector::Private::addBytes(
+    const v8::FunctionCallbackInfo<v8::Value> &args) {
+  addField(args,
+           ItemValue(slice(*payload, u32(args, 6), u32(args, 7)),
+                     text(args, 4)),
+           6);
+}
+
+WasmDissector::WasmDissector(v8::Isolate *isolate, const std::string &binary)
+    : d(new Private(isolate)) {
+  v8::HandleScope handle_scope(isolate);
+  v8::TryCatch try_catch(isolate);
+  v8::Local<v8::Context> context = isolate->GetCurrentContext();
+  v8::Local<v8::Value> wasm = get(isolate, context->Global(), "WebAssembly");
+  if (wasm.IsEmpty() || !wasm->IsObject())
+    throw std::runtime_error("WebAssembly is not supported");
+
+  v8::Local<v8::ArrayBuffer> bytes =
+      v8::ArrayBuffer::New(isolate, binary.size());
+  std::memcpy(bytes->GetContents().Data(), binary.data(), binary.size());
+
+  v8::Local<v8::Object> imports = v8::Object::New(isolate);
+  v8::Local<v8::Object> dripcap = v8::Object::New(isolate);
+  v8::Local<v8::External> data = v8::External::New(isolate, d.get());
+  const std::pair<const char *, v8::FunctionCallback> functions[] = {
+      {"namespace", &Private::call<&Private::addNamespace>},
+      {"layer", &Private::call<&Private::startLayer>},
+      {"summary", &Private::call<&Private::setSummary>},
+      {"payload", &Private::call<&Private::setPayload>},
+      {"number", &Private::call<&Private::addNumber>},
+      {"string", &Private::call<&Private::addString>},
+      {"bytes", &Private::call<&Private::addBytes>}};
+  for (const auto &pair : functions) {
+    dripcap->Set(
+        v8pp::to_v8(isolate, pair.first),
+        v8::FunctionTemplate::New(isolate, pair.second, data)->GetFunction());
+  }
+  imports->Set(v8pp::to_v8(isolate, "dripcap"), dripcap);
+
+  v8::Local<v8::Value> moduleCtor = get(isolate, wasm, "Module");
+  v8::Local<v8::Value> instanceCtor = get(isolate, wasm, "Instance");
+  if (moduleCtor.IsEmpty() || !moduleCtor->IsFunction() ||
+      instanceCtor.IsEmpty() || !instanceCtor->IsFunction())
+    throw std::runtime_error("WebAssembly is not supported");
+
+  v8::Local<v8::Value> moduleArgs[1] = {bytes};
+  v8::Local<v8::Object> module =
+      moduleCtor.As<v8::Function>()->NewInstance(1, moduleArgs);
+  if (module.IsEmpty())
+    throw std::runtime_error(exceptionMessage(isolate, try_catch));
+
+  v8::Local<v8::Value> instanceArgs[2] = {module, imports};
+  v8::Local<v8::Object> instance =
+      instanceCtor.As<v8::Function>()->NewInstance(2, instanceArgs);
+  if (instance.IsEmpty())
+    throw std::runtime_error(exceptionMessage(isolate, try_catch));
+
+  v8::Local<v8::Value> exports = get(isolate, instance, "exports");
+  v8::Local<v8::Value> memory = get(isolate, exports, "memory");
+  v8::Local<v8::Value> input = get(isolate, exports, "input");
+  v8::Local<v8::Value> analyze = get(isolate, exports, "analyze");
+  v8::Local<v8::Value> init = get(isolate, exports, "init");
+  if (memory.IsEmpty() || !memory->IsObject())
+    throw std::runtime_error("module does not export memory");
+  if (input.IsEmpty() || !input->IsFunction() || analyze.IsEmpty() ||
+      !analyze->IsFunction())
+    throw std::runtime_error("module does not export input and analyze");
+  d->memoryObj.Reset(isolate, memory.As<v8::Object>());
+  d->input.Reset(isolate, input.As<v8::Function>());
+  d->analyze.Reset(isolate, analyze.As<v8::Function>());
+
+  if (!init.IsEmpty() && init->IsFunction()) {
+    d->initializing = true;
+    v8::Local<v8::Value> result =
+        init.As<v8::Function>()->Call(context->Global(), 0, nullptr);
+    d->initializing = false;
+    if (result.IsEmpty())
+      throw std::runtime_error(exceptionMessage(isolate, try_catch));
+  }
+}
+
+WasmDissector::~WasmDissector() {}
+
+DissectorNamespaces WasmDissector::namespaces() const { return d->namespaces; }
+
+void WasmDissector::analyze(
+    const Packet &, const Layer &parentLayer,
+    std::vector<std::shared_ptr<Layer>> *layers,
+    std::vector<std::unique_ptr<StreamChunk>> *) const {
+  v8::Isolate *isolate = d->isolate;
+  v8::HandleScope handle_scope(isolate);
+  v8::TryCatch try_catch(isolate);
+  v8::Local<v8::Object> global = isolate->GetCurrentContext()->Global();
+  const std::unique_ptr<Buffer> payload = payloadOf(parentLayer);
+
+  v8::Local<v8::Value> lengthArg[1] = {
+      v8pp::to_v8(isolate, static_cast<uint32_t>(payload->length()))};
+  v8::Local<v8::Value> address =
+      v8::Local<v8::Function>::New(isolate, d->input)->Call(global, 1,
+                                                            lengthArg);
+  if (address.IsEmpty())
+    throw std::runtime_error(exceptionMessage(isolate, try_catch));
+  std::memcpy(d->memory(v8pp::from_v8<uint32_t>(isolate, address, 0),
+                        payload->length()),
+              payload->data(), payload->length());
+
+  d->payload = payload.get();
+  d->layers = layers;
+  v8::Local<v8::Value> result =
+      v8::Local<v8::Function>::New(isolate, d->analyze)->Call(global, 1,
+                                                              lengthArg);
+  d->payload = nullptr;
+  d->layers = nullptr;
+  d->current.reset();
+
+  if (result.IsEmpty())
+    throw std::runtime_error(exceptionMessage(isolate, try_catch));
+  const int32_t status = v8pp::from_v8<int32_t>(isolate, result, -1);
+  if (status != 0)
+    throw std::runtime_error("analyze returned " + std::to_string(status));
+}
+
+bool WasmDissector::isModule(const std::string &script) {
+  return script.size() >= sizeof(wasmMagic) &&
+         std::memcmp(script.data(), wasmMagic, sizeof(wasmMagic)) == 0;
+}
@@ -0,0 +1,49 @@
+#ifndef WASM_DISSECTOR_HPP
+#define WASM_DISSECTOR_HPP
+
+#include "native_dissector.hpp"
+#include <memory>
+#include <string>
+#include <v8.h>
+
+// A dissector compiled from a WebAssembly module. Unlike other native
+// dissectors it runs in the isolate of the dissector thread that created
+// it, so it is never shared through the registry. The parent payload is
+// copied into the module's linear memory and fields are emitted through
+// imports instead of building script objects for every packet.
+//
+// The module exports memory, an optional init(), input(length) returning
+// the address of a buffer for |length| bytes and analyze(length)
+// returning 0 on success. Imports come from "dripcap"; strings are passed
+// as (address, length) pairs and ranges are offsets into the payload:
+//
+//   namespace(ns)                     from init(); "/.../" is a regex
+//   layer(ns, name, id)               starts a child layer
+//   summary(text)
+//   payload(start, end)               end < 0 means the rest
+//   number(name, id, value, start, end)
+//   string(name, id, text, start, end)
+//   bytes(name, id, type, start, end) type may name an address type
+//
+// A field with a non-empty id is also set as an attr of that name.
+class WasmDissector : public NativeDissector {
+public:
+  // Throws std::runtime_error if the module cannot be instantiated.
+  WasmDissector(v8::Isolate *isolate, const std::string &binary);
+  ~WasmDissector();
+  DissectorNamespaces namespaces() const override;
+  void analyze(const Packet &packet, const Layer &parentLayer,
+               std::vector<std::shared_ptr<Layer>> *layers,
+               std::vector<std::unique_ptr<StreamChunk>> *streams)
+      const override;
+
+public:
+  // Returns true if |script| starts with the WebAssembly magic number.
+  static bool isModule(const std::string &script);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "watchdog.hpp"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+namespace {
+int64_t nowMsec() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+}
+
+class Watchdog::Private {
+public:
+  Private(uint32_t timeout);
+  ~Private();
+  void check();
+
+public:
+  uint32_t timeout;
+  std::thread thread;
+  std::mutex mutex;
+  std::condition_variable cond;
+  std::vector<std::weak_ptr<Slot>> slots;
+  bool closed = false;
+};
+
+Watchdog::Private::Private(uint32_t timeout) : timeout(timeout) {
+  if (timeout == 0)
+    return;
+
+  // Polling at a quarter of the budget lets a call overrun by at most 25%.
+  const auto interval =
+      std::chrono::milliseconds(std::max<uint32_t>(timeout / 4, 1));
+  thread = std::thread([this, interval]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!closed) {
+      cond.wait_for(lock, interval);
+      if (!closed)
+        check();
+    }
+  });
+}
+
+Watchdog::Private::~Private() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    closed = true;
+  }
+  cond.notify_all();
+  if (thread.joinable())
+    thread.join();
+}
+
+// Called with |mutex| held. The slot mutex keeps disarm() from cancelling
+// before the termination has been requested.
+void Watchdog::Private::check() {
+  const int64_t now = nowMsec();
+  slots.erase(std::remove_if(slots.begin(), slots.end(),
+                             [](const std::weak_ptr<Slot> &slot) {
+                               return slot.expired();
+                             }),
+              slots.end());
+  for (const std::weak_ptr<Slot> &weak : slots) {
+    const std::shared_ptr<Slot> &slot = weak.lock();
+    if (!slot)
+      continue;
+    int64_t deadline = slot->deadline.load();
+    if (deadline <= 0 || deadline > now)
+      continue;
+    std::lock_guard<std::mutex> lock(slot->mutex);
+    if (slot->deadline.compare_exchange_strong(deadline, -1))
+      slot->isolate->TerminateExecution();
+  }
+}
+
+Watchdog::Slot::Slot(v8::Isolate *isolate, uint32_t timeout)
+    : isolate(isolate), timeout(timeout), deadline(0) {}
+
+void Watchdog::Slot::arm() {
+  if (timeout > 0)
+    deadline.store(nowMsec() + timeout);
+}
+
+bool Watchdog::Slot::disarm() {
+  if (timeout == 0 || deadline.exchange(0) != -1)
+    return false;
+  std::lock_guard<std::mutex> lock(mutex);
+  isolate->CancelTerminateExecution();
+  return true;
+}
+
+Watchdog::Watchdog(uint32_t timeout) : d(new Private(timeout)) {}
+
+Watchdog::~Watchdog() {}
+
+uint32_t Watchdog::timeout() const { return d->timeout; }
+
+std::shared_ptr<Watchdog::Slot> Watchdog::watch(v8::Isolate *isolate) {
+  auto slot = std::make_shared<Slot>(isolate, d->timeout);
+  if (d->timeout > 0) {
+    std::lock_guard<std::mutex> lock(d->mutex);
+    d->slots.push_back(slot);
+  }
+  return slot;
+}
@@ -0,0 +1,49 @@
+#ifndef WATCHDOG_HPP
+#define WATCHDOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <v8.h>
+
+// Terminates script calls that run longer than |timeout| milliseconds. One
+// thread watches the isolates of a whole pipeline; a timeout of 0 disables
+// it and starts no thread.
+class Watchdog {
+public:
+  // Deadline of the call running in one isolate. Only the thread owning the
+  // isolate may arm it.
+  class Slot {
+  public:
+    Slot(v8::Isolate *isolate, uint32_t timeout);
+    Slot(const Slot &) = delete;
+    Slot &operator=(const Slot &) = delete;
+    void arm();
+    // Returns true if the call was terminated. The isolate can run scripts
+    // again afterwards.
+    bool disarm();
+
+  private:
+    friend class Watchdog;
+    v8::Isolate *isolate;
+    uint32_t timeout;
+    // Milliseconds on the steady clock; 0 when disarmed and -1 once fired.
+    std::atomic<int64_t> deadline;
+    std::mutex mutex;
+  };
+
+public:
+  explicit Watchdog(uint32_t timeout);
+  ~Watchdog();
+  Watchdog(const Watchdog &) = delete;
+  Watchdog &operator=(const Watchdog &) = delete;
+  uint32_t timeout() const;
+  std::shared_ptr<Slot> watch(v8::Isolate *isolate);
+
+private:
+  class Private;
+  std::unique_ptr<Private> d;
+};
+
+#endif